@@ -0,0 +1,96 @@
+/**
+ * @file alloc_bench.cc
+ * @brief counts the heap allocations of Matcher::Run with a counting, a text
+ * and a callback sink, to check that the search itself does not allocate
+ *
+ */
+
+#include "candidate_set.h"
+#include "common.h"
+#include "graph.h"
+#include "matcher.h"
+#include "result_sink.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <fcntl.h>
+#include <new>
+#include <unistd.h>
+
+namespace {
+std::atomic<size_t> num_allocations{0};
+}  // namespace
+
+void* operator new(size_t size) {
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+  void* p = std::malloc(size == 0 ? 1 : size);
+  if (p == nullptr) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+int main(int argc, char* argv[]) {
+  if (argc != 3 && argc != 4) {
+    std::cerr << "Usage: ./alloc_bench <data graph file> <query graph file> "
+                 "[<candidate set file>]\n";
+    return EXIT_FAILURE;
+  }
+
+  Graph data(argv[1]);
+  Graph query(argv[2], data);
+  CandidateSet candidate_set =
+      argc == 4 ? CandidateSet(argv[3]) : CandidateSet(data, query);
+
+  // setup allocates the same whatever the limit, so every search after the
+  // first should allocate the same amount however far it goes, whether the
+  // matches are only counted or copied out to a sink
+  int null_fd = open("/dev/null", O_WRONLY);
+  TextSink text_sink(null_fd);
+  size_t checksum = 0;
+  CallbackSink callback_sink([&checksum](const Vertex* row, size_t size) {
+    checksum += row[size - 1];
+  });
+  CountSink count_sink;
+  std::vector<std::pair<const char*, ResultSink*>> sinks = {
+      {"count", &count_sink}, {"text", &text_sink},
+      {"callback", &callback_sink}};
+  std::vector<size_t> limits = {1, 1, 100, 100000};
+
+  bool steady = true;
+  std::cout << "sink\tlimit\tmatches\tnodes\tallocations\t"
+               "arena allocations\tarena KB\tarena heap blocks\n";
+  for (const std::pair<const char*, ResultSink*>& sink : sinks) {
+    Matcher matcher(1);
+    std::vector<size_t> counts;
+    for (size_t limit : limits) {
+      for (bool failing_sets : {false, true}) {
+        MatchOptions options;
+        options.limit = limit;
+        options.failing_sets = failing_sets;
+
+        size_t before = num_allocations.load();
+        MatchStats stats =
+            matcher.Run(data, query, candidate_set, options, *sink.second);
+        size_t allocations = num_allocations.load() - before;
+
+        std::cout << sink.first << "\t" << limit << (failing_sets ? " fs" : "")
+                  << "\t" << stats.num_matches << "\t" << stats.num_nodes
+                  << "\t" << allocations << "\t" << stats.arena_allocations
+                  << "\t" << stats.arena_bytes / 1024 << "\t"
+                  << stats.heap_blocks << "\n";
+        counts.push_back(allocations);
+      }
+    }
+    // the first two runs size the per-worker buffers
+    if (!std::equal(counts.begin() + 3, counts.end(), counts.begin() + 2)) {
+      std::cout << "the search allocates with the " << sink.first
+                << " sink!\n";
+      steady = false;
+    }
+  }
+  close(null_fd);
+
+  if (steady) std::cout << "no allocation in the search\n";
+  return steady ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file intersection_bench.cc
+ * @brief cross-check and per-call time of the set-intersection kernels
+ *
+ */
+
+#include "common.h"
+#include "intersection.h"
+
+#include <chrono>
+#include <random>
+
+namespace {
+struct ListPair {
+  std::vector<uint32_t> a;
+  std::vector<uint32_t> b;
+};
+
+// size strictly increasing elements of [0, universe)
+std::vector<uint32_t> RandomList(std::mt19937& rng, size_t size,
+                                 uint32_t universe) {
+  std::vector<uint32_t> list;
+  list.reserve(size);
+  for (uint32_t x = 0; x < universe && list.size() < size; ++x)
+    if (rng() % (universe - x) < size - list.size()) list.push_back(x);
+  return list;
+}
+
+std::vector<ListPair> MakePairs(size_t num_pairs, size_t na, size_t nb,
+                                uint32_t universe) {
+  std::mt19937 rng(2021);
+  std::vector<ListPair> pairs(num_pairs);
+  for (ListPair& p : pairs) {
+    p.a = RandomList(rng, na, universe);
+    p.b = RandomList(rng, nb, universe);
+  }
+  return pairs;
+}
+
+/**
+ * @brief Intersects every pair with each kernel the CPU supports, checks the
+ * results against the scalar kernel and prints the time per call.
+ *
+ * @return bool false if a kernel disagreed with the scalar one.
+ */
+bool Measure(const char* name, const std::vector<ListPair>& pairs,
+             size_t runs) {
+  size_t max_size = 0;
+  for (const ListPair& p : pairs)
+    max_size = std::max(max_size, std::min(p.a.size(), p.b.size()));
+  std::vector<uint32_t> out(max_size + kIntersectionPadding);
+
+  IntersectionKernel supported = GetIntersectionKernel();
+  std::vector<std::vector<uint32_t>> expected(pairs.size());
+  bool agree = true;
+  std::cout << name;
+  for (IntersectionKernel kernel :
+       {IntersectionKernel::kScalar, IntersectionKernel::kSSE,
+        IntersectionKernel::kAVX2}) {
+    SetIntersectionKernel(kernel);
+    if (GetIntersectionKernel() != kernel) continue;
+
+    // checked first, which also warms the caches for the timed runs
+    for (size_t i = 0; i < pairs.size(); ++i) {
+      const ListPair& p = pairs[i];
+      size_t n = Intersect(p.a.data(), p.a.size(), p.b.data(), p.b.size(),
+                           out.data());
+      std::vector<uint32_t> result(out.begin(), out.begin() + n);
+      if (kernel == IntersectionKernel::kScalar) {
+        expected[i].swap(result);
+      } else if (result != expected[i]) {
+        agree = false;
+      }
+    }
+
+    size_t total = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < runs; ++r)
+      for (const ListPair& p : pairs)
+        total += Intersect(p.a.data(), p.a.size(), p.b.data(), p.b.size(),
+                           out.data());
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "\t" << GetIntersectionKernelName(kernel) << " "
+              << std::chrono::duration<double, std::nano>(end - start)
+                         .count() /
+                     (runs * pairs.size())
+              << " ns/call";
+    if (kernel == IntersectionKernel::kScalar)
+      std::cout << " (" << total / runs << " common)";
+  }
+  std::cout << (agree ? "" : "\tMISMATCH") << "\n";
+  SetIntersectionKernel(supported);
+  return agree;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  size_t runs = 10;
+  size_t num_pairs = 1000;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-r" && i + 1 < argc) {
+      runs = std::max<size_t>(std::stoul(argv[++i]), 1);
+    } else if (arg.size() > 0 && arg[0] != '-') {
+      num_pairs = std::stoul(arg);
+    } else {
+      std::cerr << "Usage: ./intersection_bench [-r runs] [num pairs]\n";
+      return EXIT_FAILURE;
+    }
+  }
+  std::cout << "kernel in use: "
+            << GetIntersectionKernelName(GetIntersectionKernel()) << "\n";
+
+  // half-dense lists of equal size, sparse ones, lists of a few blocks, and
+  // sizes skewed enough for the scalar kernel to gallop
+  bool agree = true;
+  agree &= Measure("2048 x 2048 of 4096",
+                   MakePairs(num_pairs, 2048, 2048, 4096), runs);
+  agree &= Measure("2048 x 2048 of 65536",
+                   MakePairs(num_pairs, 2048, 2048, 65536), runs);
+  agree &= Measure("16 x 16 of 64", MakePairs(num_pairs, 16, 16, 64), runs);
+  agree &= Measure("128 x 4096 of 8192", MakePairs(num_pairs, 128, 4096, 8192),
+                   runs);
+  agree &= Measure("16 x 65536 of 131072",
+                   MakePairs(num_pairs / 10 + 1, 16, 65536, 131072), runs);
+
+  if (!agree) {
+    std::cerr << "The kernels disagree with the scalar kernel!\n";
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file is_neighbor_bench.cc
+ * @brief micro-benchmark of Graph::IsNeighbor
+ *
+ */
+
+#include "common.h"
+#include "graph.h"
+
+#include <chrono>
+#include <random>
+
+namespace {
+// the previous layout: label segments sorted by descending degree, then id
+class LegacyAdjacency {
+ public:
+  explicit LegacyAdjacency(const Graph& g) : g_(g), adj_(2 * g.GetNumEdges()) {
+    for (size_t v = 0; v < g.GetNumVertices(); ++v) {
+      for (size_t i = g.GetNeighborStartOffset(v);
+           i < g.GetNeighborEndOffset(v); ++i)
+        adj_[i] = g.GetNeighbor(i);
+      for (size_t l = 0; l < g.GetNumLabels(); ++l) {
+        std::sort(adj_.begin() + g.GetNeighborStartOffset(v, l),
+                  adj_.begin() + g.GetNeighborEndOffset(v, l),
+                  [this](Vertex a, Vertex b) { return Less(a, b); });
+      }
+    }
+  }
+
+  bool IsNeighbor(Vertex u, Vertex v) const {
+    if (g_.GetNeighborLabelFrequency(u, g_.GetLabel(v)) >
+        g_.GetNeighborLabelFrequency(v, g_.GetLabel(u)))
+      std::swap(u, v);
+    auto begin = adj_.begin() + g_.GetNeighborStartOffset(u, g_.GetLabel(v));
+    auto end = adj_.begin() + g_.GetNeighborEndOffset(u, g_.GetLabel(v));
+    auto it = std::lower_bound(begin, end, v, [this](Vertex a, Vertex b) {
+      return Less(a, b);
+    });
+    return it != end && *it == v;
+  }
+
+ private:
+  bool Less(Vertex a, Vertex b) const {
+    if (g_.GetDegree(a) != g_.GetDegree(b))
+      return g_.GetDegree(a) > g_.GetDegree(b);
+    return a < b;
+  }
+
+  const Graph& g_;
+  std::vector<Vertex> adj_;
+};
+
+template <typename F>
+void Measure(const char* name, const std::vector<std::pair<Vertex, Vertex>>& pairs,
+             F is_neighbor) {
+  size_t found = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (auto& p : pairs) found += is_neighbor(p.first, p.second);
+  auto end = std::chrono::steady_clock::now();
+  std::cout << name << "\t"
+            << std::chrono::duration<double, std::nano>(end - start).count() /
+                   pairs.size()
+            << " ns/call\t" << found << " edges\n";
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: ./is_neighbor_bench <data graph file> [num pairs]\n";
+    return EXIT_FAILURE;
+  }
+  size_t num_pairs = argc > 2 ? std::stoul(argv[2]) : 10000000;
+
+  Graph indexed(argv[1]);
+  Graph plain(argv[1], SIZE_MAX);
+  LegacyAdjacency legacy(plain);
+  std::cout << indexed.GetNumIndexedVertices() << " vertices with degree >= "
+            << std::max(kDefaultEdgeIndexThreshold,
+                        (plain.GetNumVertices() + 63) / 64)
+            << " have a bitmap\n";
+
+  // half edges, half two-hop pairs, which share a label segment but are
+  // mostly not adjacent
+  std::mt19937 rng(2021);
+  std::vector<std::pair<Vertex, Vertex>> pairs;
+  pairs.reserve(num_pairs);
+  while (pairs.size() < num_pairs) {
+    Vertex u = rng() % plain.GetNumVertices();
+    if (plain.GetDegree(u) == 0) continue;
+    Vertex v = plain.GetNeighbor(plain.GetNeighborStartOffset(u) +
+                                 rng() % plain.GetDegree(u));
+    if (pairs.size() % 2 == 1 && plain.GetDegree(v) > 0)
+      v = plain.GetNeighbor(plain.GetNeighborStartOffset(v) +
+                            rng() % plain.GetDegree(v));
+    pairs.emplace_back(u, v);
+  }
+
+  Measure("legacy", pairs,
+          [&legacy](Vertex u, Vertex v) { return legacy.IsNeighbor(u, v); });
+  Measure("sorted", pairs,
+          [&plain](Vertex u, Vertex v) { return plain.IsNeighbor(u, v); });
+  Measure("bitmap", pairs,
+          [&indexed](Vertex u, Vertex v) { return indexed.IsNeighbor(u, v); });
+
+  return EXIT_SUCCESS;
+}
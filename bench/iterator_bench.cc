@@ -0,0 +1,69 @@
+/**
+ * @file iterator_bench.cc
+ * @brief what the first k embeddings cost through MatchIterator, against a
+ * Matcher run limited to k
+ *
+ */
+
+#include "candidate_set.h"
+#include "common.h"
+#include "graph.h"
+#include "match_iterator.h"
+#include "matcher.h"
+#include "result_sink.h"
+
+#include <chrono>
+
+namespace {
+double ElapsedMs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 4) {
+    std::cerr << "Usage: ./iterator_bench <data graph file> <query graph file> "
+                 "<candidate set file> [k...]\n";
+    return EXIT_FAILURE;
+  }
+  std::vector<size_t> ks;
+  for (int i = 4; i < argc; ++i) ks.push_back(std::stoull(argv[i]));
+  if (ks.empty()) ks = {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+  Graph data(argv[1]);
+  Graph query(argv[2], data);
+  CandidateSet cs(argv[3], data);
+
+  std::cout << "k\titerator matches\titerator nodes\titerator ms\t"
+               "matcher matches\tmatcher nodes\tmatcher ms\n";
+  for (size_t k : ks) {
+    MatchOptions options;
+    options.limit = SIZE_MAX;
+    // the consumer stops after k
+    auto start = std::chrono::steady_clock::now();
+    MatchIterator iterator(data, query, cs, options);
+    uint64_t checksum = 0;
+    const Vertex* embedding;
+    while (iterator.GetNumMatches() < k &&
+           (embedding = iterator.Next()) != nullptr)
+      checksum += embedding[0];
+    double iterator_ms = ElapsedMs(start);
+
+    options.limit = k;
+    Matcher matcher;
+    CallbackSink sink([&checksum](const Vertex* embedding, size_t) {
+      checksum += embedding[0];
+    });
+    start = std::chrono::steady_clock::now();
+    MatchStats stats = matcher.Run(data, query, cs, options, sink);
+    double matcher_ms = ElapsedMs(start);
+
+    std::cout << k << "\t" << iterator.GetNumMatches() << "\t"
+              << iterator.GetNumNodes() << "\t" << iterator_ms << "\t"
+              << stats.num_matches << "\t" << stats.num_nodes << "\t"
+              << matcher_ms << "\t(" << checksum << ")\n";
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,90 @@
+/**
+ * @file label_index_bench.cc
+ * @brief memory and lookup latency of the per-vertex label segment index
+ *
+ */
+
+#include "common.h"
+#include "graph.h"
+
+#include <chrono>
+#include <random>
+
+namespace {
+// the previous index: a dense (start, end) pair per (vertex, label)
+class LegacyLabelIndex {
+ public:
+  explicit LegacyLabelIndex(const Graph& g)
+      : num_labels_(g.GetNumLabels()),
+        table_(g.GetNumVertices() * num_labels_) {
+    for (size_t v = 0; v < g.GetNumVertices(); ++v)
+      for (size_t l = 0; l < num_labels_; ++l)
+        table_[v * num_labels_ + l] = std::make_pair(
+            g.GetNeighborStartOffset(v, l), g.GetNeighborEndOffset(v, l));
+  }
+
+  size_t GetNeighborLabelFrequency(Vertex v, Label l) const {
+    const std::pair<size_t, size_t>& p = table_[v * num_labels_ + l];
+    return p.second - p.first;
+  }
+
+  size_t GetBytes() const {
+    return sizeof(std::pair<size_t, size_t>) * table_.size();
+  }
+
+ private:
+  size_t num_labels_;
+  std::vector<std::pair<size_t, size_t>> table_;
+};
+
+template <typename F>
+void Measure(const char* name, const std::vector<std::pair<Vertex, Label>>& keys,
+             F frequency) {
+  size_t total = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (auto& k : keys) total += frequency(k.first, k.second);
+  auto end = std::chrono::steady_clock::now();
+  std::cout << name << "\t"
+            << std::chrono::duration<double, std::nano>(end - start).count() /
+                   keys.size()
+            << " ns/lookup\t(checksum " << total << ")\n";
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: ./label_index_bench <data graph file> [num lookups]\n";
+    return EXIT_FAILURE;
+  }
+  size_t num_keys = argc > 2 ? std::stoul(argv[2]) : 10000000;
+
+  Graph data(argv[1]);
+  LegacyLabelIndex legacy(data);
+
+  std::cout << (data.HasDenseLabelIndex() ? "dense" : "sparse") << " index "
+            << data.GetLabelIndexBytes() << " bytes, legacy "
+            << legacy.GetBytes() << " bytes, adjacency "
+            << sizeof(Vertex) * data.GetNumEdges() * 2 << " bytes\n";
+
+  // half labels of an actual neighbor, half arbitrary labels
+  std::mt19937 rng(2021);
+  std::vector<std::pair<Vertex, Label>> keys;
+  keys.reserve(num_keys);
+  while (keys.size() < num_keys) {
+    Vertex v = rng() % data.GetNumVertices();
+    Label l = rng() % data.GetNumLabels();
+    if (keys.size() % 2 == 0 && data.GetDegree(v) > 0)
+      l = data.GetLabel(data.GetNeighbor(data.GetNeighborStartOffset(v) +
+                                         rng() % data.GetDegree(v)));
+    keys.emplace_back(v, l);
+  }
+
+  Measure("legacy", keys, [&legacy](Vertex v, Label l) {
+    return legacy.GetNeighborLabelFrequency(v, l);
+  });
+  Measure("current", keys, [&data](Vertex v, Label l) {
+    return data.GetNeighborLabelFrequency(v, l);
+  });
+
+  return EXIT_SUCCESS;
+}
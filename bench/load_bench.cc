@@ -0,0 +1,56 @@
+/**
+ * @file load_bench.cc
+ * @brief load-time benchmark of the graph and candidate set readers
+ *
+ */
+
+#include "candidate_set.h"
+#include "common.h"
+#include "graph.h"
+
+#include <chrono>
+
+namespace {
+template <typename F>
+double AverageMillis(size_t runs, F load) {
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < runs; ++i) load();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count() / runs;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: ./load_bench [-r runs] <data graph file> "
+                 "[candidate set files...]\n";
+    return EXIT_FAILURE;
+  }
+
+  size_t runs = 10;
+  int arg = 1;
+  if (std::string(argv[arg]) == "-r" && arg + 2 < argc) {
+    runs = std::stoul(argv[arg + 1]);
+    arg += 2;
+  }
+
+  std::string data_file_name = argv[arg++];
+  double graph_ms = AverageMillis(runs, [&data_file_name]() {
+    Graph data(data_file_name);
+  });
+  std::cout << data_file_name << "\t" << graph_ms << " ms\n";
+
+  double total_cs_ms = 0;
+  for (; arg < argc; ++arg) {
+    std::string candidate_set_file_name = argv[arg];
+    double cs_ms = AverageMillis(runs, [&candidate_set_file_name]() {
+      CandidateSet candidate_set(candidate_set_file_name);
+    });
+    std::cout << candidate_set_file_name << "\t" << cs_ms << " ms\n";
+    total_cs_ms += cs_ms;
+  }
+  if (total_cs_ms > 0)
+    std::cout << "candidate sets total\t" << total_cs_ms << " ms\n";
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,140 @@
+/**
+ * @file matcher_bench.cc
+ * @brief runs one query through the Matcher library API and reports its
+ * statistics
+ *
+ */
+
+#include "candidate_set.h"
+#include "common.h"
+#include "graph.h"
+#include "matcher.h"
+#include "plan_cache.h"
+#include "result_sink.h"
+
+#include <thread>
+
+int main(int argc, char* argv[]) {
+  std::vector<std::string> file_names;
+  size_t runs = 1;
+  size_t num_threads = 1;
+  double cancel_after_ms = 0;
+  bool embeddings = false;
+  std::string profile_prefix;
+  bool plan_cache = false;
+  std::string plan_directory;
+  VertexOrder vertex_order = VertexOrder::kOriginal;
+  MatchOptions options;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-r" && i + 1 < argc) {
+      runs = std::stoul(argv[++i]);
+    } else if (arg == "--threads" && i + 1 < argc) {
+      num_threads = std::stoul(argv[++i]);
+    } else if (arg == "--limit" && i + 1 < argc) {
+      options.limit = std::stoul(argv[++i]);
+    } else if (arg == "--time-budget" && i + 1 < argc) {
+      options.time_budget_ms = std::stod(argv[++i]);
+    } else if (arg == "--cancel-after" && i + 1 < argc) {
+      cancel_after_ms = std::stod(argv[++i]);
+    } else if (arg == "--first") {
+      options.first_match_only = true;
+    } else if (arg == "--failing-sets") {
+      options.failing_sets = true;
+    } else if (arg == "--no-leaves") {
+      options.leaf_decomposition = false;
+    } else if (arg == "--no-symmetry") {
+      options.symmetry_breaking = false;
+    } else if (arg == "--reorder" && i + 1 < argc) {
+      if (!ParseVertexOrder(argv[++i], &vertex_order)) {
+        std::cerr << "Unknown vertex order " << argv[i] << "\n";
+        return EXIT_FAILURE;
+      }
+    } else if (arg == "--embeddings") {
+      embeddings = true;
+    } else if (arg == "--profile" && i + 1 < argc) {
+      profile_prefix = argv[++i];
+    } else if (arg == "--plan-cache") {
+      plan_cache = true;
+    } else if (arg == "--plan-dir" && i + 1 < argc) {
+      plan_cache = true;
+      plan_directory = argv[++i];
+    } else {
+      file_names.push_back(arg);
+    }
+  }
+
+  if (file_names.size() != 2 && file_names.size() != 3) {
+    std::cerr << "Usage: ./matcher_bench [-r runs] [--threads N] [--limit N] "
+                 "[--time-budget MS] [--cancel-after MS] [--first] "
+                 "[--failing-sets] [--no-leaves] [--no-symmetry] "
+                 "[--embeddings] [--reorder none|degree|bfs] "
+                 "[--profile PREFIX] [--plan-cache] [--plan-dir DIR] "
+                 "<data graph file> <query graph file> "
+                 "[<candidate set file>]\n";
+    return EXIT_FAILURE;
+  }
+
+  Graph data(file_names[0]);
+  data.Reorder(vertex_order);
+  Graph query(file_names[1], data);
+  CandidateSet candidate_set = file_names.size() == 3
+                                   ? CandidateSet(file_names[2], data)
+                                   : CandidateSet(data, query);
+
+  // the runs after the first reuse its plan
+  PlanCache cache(PlanCache::kDefaultCapacity, plan_directory);
+  if (plan_cache) options.plan_cache = &cache;
+
+  Matcher matcher(num_threads);
+  std::cout << "run\tmatches\tnodes\tms\tstatus\tsetup ms\n";
+  for (size_t run = 0; run < runs; ++run) {
+    std::atomic<bool> cancel{false};
+    std::thread canceller;
+    if (cancel_after_ms > 0) {
+      options.cancel = &cancel;
+      canceller = std::thread([&cancel, cancel_after_ms]() {
+        std::this_thread::sleep_for(
+            std::chrono::duration<double, std::milli>(cancel_after_ms));
+        cancel = true;
+      });
+    }
+
+    // the embeddings are copied out of the search but thrown away
+    CountSink count_sink;
+    CallbackSink callback_sink([](const Vertex*, size_t) {});
+    ResultSink& sink = embeddings ? static_cast<ResultSink&>(callback_sink)
+                                  : count_sink;
+    MatchStats stats = matcher.Run(data, query, candidate_set, options, sink);
+    if (canceller.joinable()) canceller.join();
+
+    std::cout << run << "\t" << stats.num_matches << "\t" << stats.num_nodes
+              << "\t" << stats.elapsed_ms << "\t"
+              << GetMatchStatusName(stats.status) << "\t" << stats.setup_ms
+              << (stats.plan_cached ? " (cached)" : "") << "\n";
+  }
+  if (plan_cache) {
+    const PlanCacheStats& cache_stats = cache.GetStats();
+    std::cerr << "plan cache: " << cache_stats.hits << " hits ("
+              << cache_stats.disk_loads << " from disk), "
+              << cache_stats.misses << " misses, " << cache_stats.space_hits
+              << " candidate spaces reused\n";
+  }
+
+  // of the last run: a report, the same as JSON, and the sampled search
+  // tree for flamegraph.pl
+  if (!profile_prefix.empty()) {
+    const SearchProfile& profile = matcher.GetProfile();
+    if (!SearchProfile::IsEnabled())
+      std::cerr << "Built without SEARCH_PROFILE, the profile is empty\n";
+    std::ofstream report(profile_prefix + ".txt");
+    profile.WriteReport(report);
+    std::ofstream json(profile_prefix + ".json");
+    profile.WriteJson(json);
+    std::ofstream folded(profile_prefix + ".folded");
+    profile.WriteFoldedStacks(folded);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,106 @@
+#!/bin/bash
+# Checks the worker process mode against the single process search on the
+# bundled workloads, and exits nonzero on any difference.
+#
+# Usage: bench/process_check.sh <program> [worker counts...]
+#   e.g. bench/process_check.sh build/main/program 1 2 4
+#
+# Every worker count must find as many matches as one process, counted and as
+# rows, without a limit on the workloads searched in full at once and under
+# limits of 1, 1000 and 100000 on those that reach them at once. A run whose
+# worker is killed must either find every match or exit nonzero. Set TIMEOUT
+# (seconds, default 60) to bound a single run.
+
+program=${1:?usage: $0 <program> [worker counts...]}
+shift
+workers=${@:-1 2 4}
+root=$(cd "$(dirname "$0")/.." && pwd)
+failures=0
+
+# runs the program on a workload, then prints its matches and exit status
+run() {
+  local name=$1 output=$2
+  shift 2
+  local data="$root/data/${name%_*}.igraph"
+  local matches
+  if [ "$output" = count ]; then
+    matches=$(timeout "${TIMEOUT:-60}" "$program" "$data" \
+              "$root/query/$name.igraph" "$root/candidate_set/$name.cs" \
+              --output count "$@" | sed -n 's/^c //p')
+  else
+    matches=$(timeout "${TIMEOUT:-60}" "$program" "$data" \
+              "$root/query/$name.igraph" "$root/candidate_set/$name.cs" \
+              "$@" | grep -c '^a')
+  fi
+  echo "${matches:--} ${PIPESTATUS[0]}"
+}
+
+check() {
+  local name=$1 limit=$2 output=$3
+  local expected
+  expected=$(run "$name" "$output" --limit "$limit")
+  for w in $workers; do
+    local got
+    got=$(run "$name" "$output" --limit "$limit" --workers "$w")
+    if [ "$got" != "$expected" ]; then
+      printf "FAIL %-14s limit %-20s %-5s workers %2s: %s, expected %s\n" \
+             "$name" "$limit" "$output" "$w" "$got" "$expected"
+      failures=$((failures + 1))
+    fi
+  done
+}
+
+# the workloads searched in full within milliseconds
+for name in lcc_hprd_n1 lcc_hprd_n5 lcc_hprd_s1 lcc_yeast_n5; do
+  check "$name" 18446744073709551615 count
+  check "$name" 18446744073709551615 text
+done
+check lcc_hprd_n8 18446744073709551615 count
+# and those that reach the limits within milliseconds
+for name in lcc_hprd_n3 lcc_hprd_n8 lcc_hprd_s5 lcc_hprd_s8 lcc_yeast_n3 \
+            lcc_yeast_n8; do
+  for limit in 1 1000 100000; do
+    check "$name" "$limit" count
+    check "$name" "$limit" text
+  done
+done
+
+# a worker killed while the search runs: whatever the timing, the matches are
+# either all there or the run fails
+name=lcc_hprd_n8
+expected=$(run "$name" count --limit 18446744073709551615)
+for target in lcc_yeast_s8 "$name"; do
+  data="$root/data/${target%_*}.igraph"
+  out=$(mktemp)
+  "$program" "$data" "$root/query/$target.igraph" \
+      "$root/candidate_set/$target.cs" --output count --workers 4 \
+      --limit 18446744073709551615 --time-budget 3000 > "$out" 2>/dev/null &
+  pid=$!
+  for _ in $(seq 100); do
+    victim=$(pgrep -P "$pid" | head -n 1)
+    [ -n "$victim" ] && break
+    sleep 0.01
+  done
+  [ -n "$victim" ] && sleep 0.2 && kill -9 "$victim" 2>/dev/null
+  wait "$pid"
+  status=$?
+  matches=$(sed -n 's/^c //p' "$out")
+  rm -f "$out"
+  if [ "$target" = "$name" ]; then
+    # over in milliseconds, the worker was most likely killed idle or gone
+    if [ $status -eq 0 ] && [ "$matches $status" != "$expected" ]; then
+      echo "FAIL $target killed worker: $matches $status, expected $expected"
+      failures=$((failures + 1))
+    fi
+  elif [ $status -eq 0 ]; then
+    # too long to finish within the budget, the killed slice must be reported
+    echo "FAIL $target killed worker: exited with 0 after $matches matches"
+    failures=$((failures + 1))
+  fi
+done
+
+if [ $failures -gt 0 ]; then
+  echo "$failures checks failed"
+  exit 1
+fi
+echo "all checks passed"
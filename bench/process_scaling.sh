@@ -0,0 +1,35 @@
+#!/bin/bash
+# Worker process scaling benchmark on the bundled _n8 and _s8 workloads, all
+# processes on this host.
+#
+# Usage: bench/process_scaling.sh <program> [worker counts...]
+#   e.g. bench/process_scaling.sh build/main/program 1 2 4 8 16
+#
+# Prints the wall-clock time (ms) and the number of matches of each run, and
+# flags a run whose matches differ from those of the single process search.
+# Set TIMEOUT (seconds, default 300) to bound a single run, and LIMIT (default
+# 100000) to change the match limit.
+
+program=${1:?usage: $0 <program> [worker counts...]}
+shift
+workers=${@:-1 2 4 8 16}
+root=$(cd "$(dirname "$0")/.." && pwd)
+
+printf "%-16s %8s %10s %10s\n" query workers time_ms matches
+for query in "$root"/query/lcc_*_n8.igraph "$root"/query/lcc_*_s8.igraph; do
+  name=$(basename "$query" .igraph)
+  data="$root/data/${name%_*}.igraph"
+  cs="$root/candidate_set/$name.cs"
+  expected=$(timeout "${TIMEOUT:-300}" "$program" "$data" "$query" "$cs" \
+             --limit "${LIMIT:-100000}" --output count | sed -n 's/^c //p')
+  for w in $workers; do
+    start=$(date +%s%N)
+    matches=$(timeout "${TIMEOUT:-300}" "$program" "$data" "$query" "$cs" \
+              --limit "${LIMIT:-100000}" --output count --workers "$w" |
+              sed -n 's/^c //p')
+    end=$(date +%s%N)
+    printf "%-16s %8s %10s %10s%s\n" "$name" "$w" \
+           $(((end - start) / 1000000)) "${matches:--}" \
+           "$([ "$matches" != "$expected" ] && echo "  (expected ${expected:--})")"
+  done
+done
@@ -0,0 +1,92 @@
+/**
+ * @file reorder_bench.cc
+ * @brief compares the vertex orders of Graph::Reorder on the lookups of the
+ * search
+ *
+ */
+
+#include "common.h"
+#include "graph.h"
+
+#include <chrono>
+#include <cmath>
+#include <random>
+
+namespace {
+double ElapsedNs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: ./reorder_bench <data graph file> [num pairs]\n";
+    return EXIT_FAILURE;
+  }
+  size_t num_pairs = argc > 2 ? std::stoul(argv[2]) : 10000000;
+
+  // half edges, half two-hop pairs, drawn once in the ids of the file
+  std::vector<std::pair<Vertex, Vertex>> pairs;
+  {
+    Graph g(argv[1]);
+    std::mt19937 rng(2021);
+    pairs.reserve(num_pairs);
+    while (pairs.size() < num_pairs) {
+      Vertex u = rng() % g.GetNumVertices();
+      if (g.GetDegree(u) == 0) continue;
+      Vertex v = g.GetNeighbor(g.GetNeighborStartOffset(u) +
+                               rng() % g.GetDegree(u));
+      if (pairs.size() % 2 == 1 && g.GetDegree(v) > 0)
+        v = g.GetNeighbor(g.GetNeighborStartOffset(v) + rng() % g.GetDegree(v));
+      pairs.emplace_back(u, v);
+    }
+  }
+
+  std::cout << "order\treorder ms\tmean log2 gap\tIsNeighbor ns\t"
+               "neighbor degrees ns\n";
+  for (const char* name : {"none", "degree", "bfs"}) {
+    VertexOrder order;
+    ParseVertexOrder(name, &order);
+    Graph g(argv[1]);
+    auto start = std::chrono::steady_clock::now();
+    g.Reorder(order);
+    double reorder_ms = ElapsedNs(start) / 1e6;
+
+    // how far apart in memory the endpoints of an edge are
+    double gap = 0;
+    for (size_t v = 0; v < g.GetNumVertices(); ++v) {
+      for (size_t i = g.GetNeighborStartOffset(v); i < g.GetNeighborEndOffset(v);
+           ++i)
+        gap += std::log2(1.0 + std::abs(g.GetNeighbor(i) - Vertex(v)));
+    }
+    gap /= 2 * g.GetNumEdges();
+
+    std::vector<std::pair<Vertex, Vertex>> translated(pairs.size());
+    for (size_t i = 0; i < pairs.size(); ++i)
+      translated[i] = std::make_pair(g.GetInternalId(pairs[i].first),
+                                     g.GetInternalId(pairs[i].second));
+
+    size_t found = 0;
+    start = std::chrono::steady_clock::now();
+    for (auto& p : translated) found += g.IsNeighbor(p.first, p.second);
+    double is_neighbor_ns = ElapsedNs(start) / translated.size();
+
+    // what the filters do: look at every neighbor of a vertex
+    size_t degrees = 0;
+    start = std::chrono::steady_clock::now();
+    for (auto& p : translated) {
+      for (size_t i = g.GetNeighborStartOffset(p.first);
+           i < g.GetNeighborEndOffset(p.first); ++i)
+        degrees += g.GetDegree(g.GetNeighbor(i));
+    }
+    double degrees_ns = ElapsedNs(start) / translated.size();
+
+    std::cout << name << "\t" << reorder_ms << "\t" << gap << "\t"
+              << is_neighbor_ns << "\t" << degrees_ns << "\t(" << found << ", "
+              << degrees << ")\n";
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+/**
+ * @file stream_bench.cc
+ * @brief updates per second of ContinuousMatcher, over a replay that deletes
+ * a random fraction of the edges of a data graph and inserts them back
+ *
+ */
+
+#include "common.h"
+#include "continuous_matcher.h"
+#include "graph.h"
+
+#include <chrono>
+#include <cstring>
+#include <random>
+
+namespace {
+double ElapsedMs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  double fraction = 0.1;
+  unsigned seed = 2021;
+  size_t limit = SIZE_MAX;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--fraction") == 0 && i + 1 < argc)
+      fraction = std::stod(argv[++i]);
+    else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+      seed = std::stoul(argv[++i]);
+    else if (std::strcmp(argv[i], "--limit") == 0 && i + 1 < argc)
+      limit = std::stoull(argv[++i]);
+    else
+      files.push_back(argv[i]);
+  }
+  if (files.size() < 2 || fraction < 0 || fraction > 1) {
+    std::cerr << "Usage: ./stream_bench <data graph file> <query file>... "
+                 "[--fraction F] [--seed S] [--limit N]\n";
+    return EXIT_FAILURE;
+  }
+
+  Graph data(files[0]);
+  ContinuousMatcher matcher(data, limit);
+  for (size_t i = 1; i < files.size(); ++i)
+    matcher.AddQuery(Graph(files[i], data));
+
+  std::vector<std::pair<Vertex, Vertex>> edges;
+  for (size_t v = 0; v < data.GetNumVertices(); ++v) {
+    for (size_t i = data.GetNeighborStartOffset(v);
+         i < data.GetNeighborEndOffset(v); ++i)
+      if (Vertex(v) < data.GetNeighbor(i))
+        edges.emplace_back(v, data.GetNeighbor(i));
+  }
+  std::mt19937 rng(seed);
+  std::shuffle(edges.begin(), edges.end(), rng);
+  edges.resize(static_cast<size_t>(fraction * edges.size()));
+
+  // per query, the embeddings each phase destroyed and created
+  std::vector<size_t> removed(matcher.GetNumQueries(), 0);
+  std::vector<size_t> added(matcher.GetNumQueries(), 0);
+  auto count = [&removed, &added](size_t query, bool inserted, const Vertex*,
+                                  size_t) {
+    ++(inserted ? added : removed)[query];
+  };
+
+  std::cout << "phase\tupdates\tms\tupdates/s\tembeddings\tnodes\n";
+  size_t truncated = 0;
+  for (bool insert : {false, true}) {
+    size_t matches = 0, nodes = 0;
+    auto start = std::chrono::steady_clock::now();
+    // the insertions undo the deletions, last one first
+    for (size_t k = 0; k < edges.size(); ++k) {
+      const std::pair<Vertex, Vertex>& e =
+          insert ? edges[edges.size() - 1 - k] : edges[k];
+      UpdateStats stats = insert
+                              ? matcher.InsertEdge(e.first, e.second, count)
+                              : matcher.DeleteEdge(e.first, e.second, count);
+      matches += stats.num_matches;
+      nodes += stats.num_nodes;
+      truncated += stats.truncated;
+    }
+    double ms = ElapsedMs(start);
+    std::cout << (insert ? "insert" : "delete") << "\t" << edges.size() << "\t"
+              << ms << "\t" << (ms > 0 ? edges.size() / ms * 1000 : 0) << "\t"
+              << matches << "\t" << nodes << "\n";
+  }
+
+  // the replay ends on the graph it started from, so every embedding removed
+  // must come back
+  bool mismatch = false;
+  std::cout << "query\tremoved\tadded\n";
+  for (size_t q = 0; q < matcher.GetNumQueries(); ++q) {
+    std::cout << files[q + 1] << "\t" << removed[q] << "\t" << added[q]
+              << (removed[q] != added[q] ? "\tMISMATCH" : "") << "\n";
+    mismatch |= removed[q] != added[q];
+  }
+  if (truncated > 0)
+    std::cerr << truncated << " updates stopped at the limit\n";
+  return mismatch && truncated == 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,354 @@
+/**
+ * @file suite_bench.cc
+ * @brief runs every bundled workload several times and reports load,
+ * preprocessing and search time, time to first match, search nodes, matches
+ * and peak RSS, as a table and as JSON or CSV; compares with a baseline CSV
+ *
+ */
+
+#include "candidate_set.h"
+#include "common.h"
+#include "graph.h"
+#include "matcher.h"
+#include "result_sink.h"
+
+#include <chrono>
+#include <cstring>
+#include <dirent.h>
+#include <map>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+struct Workload {
+  std::string name;  // of the query, e.g. lcc_hprd_n1
+  std::string data;
+  std::string query;
+  std::string candidate_set;
+};
+
+// medians over the runs of a workload, but nodes and matches of the last run
+struct Result {
+  std::string name;
+  size_t runs = 0;
+  double load_ms = 0;
+  double setup_ms = 0;
+  double search_ms = 0;
+  double search_min_ms = 0;
+  double search_max_ms = 0;
+  double first_match_ms = -1;
+  size_t nodes = 0;
+  size_t matches = 0;
+  std::string status = "crashed";
+  long peak_rss_kb = 0;
+};
+
+const char kCsvHeader[] =
+    "name,runs,load_ms,setup_ms,search_ms,search_min_ms,search_max_ms,"
+    "first_match_ms,nodes,matches,status,peak_rss_kb";
+
+bool FileExists(const std::string& filename) {
+  return std::ifstream(filename).good();
+}
+
+double Median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  return values[values.size() / 2];
+}
+
+double ElapsedMs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// query/<data>_<kind><n>.igraph with data/<data>.igraph and
+// candidate_set/<query>.cs, in name order
+std::vector<Workload> FindWorkloads(const std::string& root,
+                                    const std::string& filter) {
+  std::vector<Workload> workloads;
+  DIR* dir = opendir((root + "/query").c_str());
+  if (dir == nullptr) return workloads;
+  while (dirent* entry = readdir(dir)) {
+    std::string file = entry->d_name;
+    size_t suffix = file.rfind(".igraph");
+    if (suffix == std::string::npos || suffix + 7 != file.size()) continue;
+    Workload w;
+    w.name = file.substr(0, suffix);
+    if (w.name.find(filter) == std::string::npos) continue;
+    size_t kind = w.name.rfind('_');
+    if (kind == std::string::npos) continue;
+    w.data = root + "/data/" + w.name.substr(0, kind) + ".igraph";
+    w.query = root + "/query/" + file;
+    w.candidate_set = root + "/candidate_set/" + w.name + ".cs";
+    if (FileExists(w.data) && FileExists(w.candidate_set))
+      workloads.push_back(w);
+  }
+  closedir(dir);
+  std::sort(workloads.begin(), workloads.end(),
+            [](const Workload& a, const Workload& b) {
+              return a.name < b.name;
+            });
+  return workloads;
+}
+
+// runs in a child process of its own, so that the peak RSS is the
+// workload's, and writes its result as one line to fd
+void RunWorkload(const Workload& w, size_t runs, size_t num_threads,
+                 const MatchOptions& options, bool count_only, int fd) {
+  std::vector<double> load, setup, search, first_match;
+  MatchStats stats;
+  Matcher matcher(num_threads);
+  for (size_t run = 0; run < runs; ++run) {
+    auto start = std::chrono::steady_clock::now();
+    Graph data(w.data);
+    Graph query(w.query, data);
+    CandidateSet candidate_set(w.candidate_set, data);
+    load.push_back(ElapsedMs(start));
+
+    // the embeddings are copied out of the search as for a real sink
+    CountSink count_sink;
+    CallbackSink callback_sink([](const Vertex*, size_t) {});
+    ResultSink& sink = count_only ? static_cast<ResultSink&>(count_sink)
+                                  : callback_sink;
+    stats = matcher.Run(data, query, candidate_set, options, sink);
+    setup.push_back(stats.setup_ms);
+    search.push_back(stats.elapsed_ms - stats.setup_ms);
+    first_match.push_back(stats.first_match_ms);
+  }
+
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  std::ostringstream line;
+  line << Median(load) << " " << Median(setup) << " " << Median(search) << " "
+       << *std::min_element(search.begin(), search.end()) << " "
+       << *std::max_element(search.begin(), search.end()) << " "
+       << Median(first_match) << " " << stats.num_nodes << " "
+       << stats.num_matches << " " << GetMatchStatusName(stats.status) << " "
+       << usage.ru_maxrss << "\n";
+  std::string text = line.str();
+  if (write(fd, text.data(), text.size()) < 0) _exit(EXIT_FAILURE);
+}
+
+Result Measure(const Workload& w, size_t runs, size_t num_threads,
+               const MatchOptions& options, bool count_only) {
+  Result result;
+  result.name = w.name;
+  result.runs = runs;
+
+  int fds[2];
+  if (pipe(fds) != 0) return result;
+  std::cout.flush();
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    RunWorkload(w, runs, num_threads, options, count_only, fds[1]);
+    _exit(EXIT_SUCCESS);
+  }
+  close(fds[1]);
+  std::string text;
+  char buffer[256];
+  ssize_t size;
+  while ((size = read(fds[0], buffer, sizeof(buffer))) > 0)
+    text.append(buffer, size);
+  close(fds[0]);
+  int status = 0;
+  if (pid > 0) waitpid(pid, &status, 0);
+
+  std::istringstream fields(text);
+  Result parsed = result;
+  if (fields >> parsed.load_ms >> parsed.setup_ms >> parsed.search_ms >>
+      parsed.search_min_ms >> parsed.search_max_ms >> parsed.first_match_ms >>
+      parsed.nodes >> parsed.matches >> parsed.status >> parsed.peak_rss_kb)
+    return parsed;
+  return result;
+}
+
+void WriteCsv(const std::vector<Result>& results, std::ostream& out) {
+  out << kCsvHeader << "\n";
+  for (const Result& r : results) {
+    out << r.name << "," << r.runs << "," << r.load_ms << "," << r.setup_ms
+        << "," << r.search_ms << "," << r.search_min_ms << ","
+        << r.search_max_ms << "," << r.first_match_ms << "," << r.nodes << ","
+        << r.matches << "," << r.status << "," << r.peak_rss_kb << "\n";
+  }
+}
+
+void WriteJson(const std::vector<Result>& results, size_t num_threads,
+               const MatchOptions& options, std::ostream& out) {
+  out << "{\n  \"threads\": " << num_threads
+      << ",\n  \"limit\": " << options.limit
+      << ",\n  \"time_budget_ms\": " << options.time_budget_ms
+      << ",\n  \"workloads\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result& r = results[i];
+    out << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << r.name
+        << "\", \"runs\": " << r.runs << ", \"load_ms\": " << r.load_ms
+        << ", \"setup_ms\": " << r.setup_ms
+        << ", \"search_ms\": " << r.search_ms
+        << ", \"search_min_ms\": " << r.search_min_ms
+        << ", \"search_max_ms\": " << r.search_max_ms
+        << ", \"first_match_ms\": " << r.first_match_ms
+        << ", \"nodes\": " << r.nodes << ", \"matches\": " << r.matches
+        << ", \"status\": \"" << r.status
+        << "\", \"peak_rss_kb\": " << r.peak_rss_kb << "}";
+  }
+  out << "\n  ]\n}\n";
+}
+
+// rows of a CSV written by WriteCsv, by workload name
+std::map<std::string, Result> ReadCsv(const std::string& filename) {
+  std::map<std::string, Result> results;
+  std::ifstream in(filename);
+  std::string line;
+  if (!std::getline(in, line) || line != kCsvHeader) return results;
+  while (std::getline(in, line)) {
+    std::replace(line.begin(), line.end(), ',', ' ');
+    std::istringstream fields(line);
+    Result r;
+    if (fields >> r.name >> r.runs >> r.load_ms >> r.setup_ms >>
+        r.search_ms >> r.search_min_ms >> r.search_max_ms >>
+        r.first_match_ms >> r.nodes >> r.matches >> r.status >> r.peak_rss_kb)
+      results[r.name] = r;
+  }
+  return results;
+}
+
+// prints how every workload moved against the baseline, and returns the
+// number of regressions: slower searches beyond the tolerance, new timeouts
+// or crashes, and different match counts. Search times are compared by their
+// fastest run, as noise only ever slows a run down
+size_t Compare(const std::vector<Result>& results,
+               const std::map<std::string, Result>& baseline,
+               double tolerance, double min_delta_ms) {
+  size_t regressions = 0;
+  std::cout << "\nworkload\tbase min ms\tmin ms\tchange\tverdict\n";
+  for (const Result& r : results) {
+    auto it = baseline.find(r.name);
+    if (it == baseline.end()) {
+      std::cout << r.name << "\t-\t" << r.search_min_ms << "\t-\tnew\n";
+      continue;
+    }
+    const Result& base = it->second;
+    double ms = r.search_min_ms, base_ms = base.search_min_ms;
+    double change = base_ms > 0 ? (ms - base_ms) / base_ms : 0;
+    const char* verdict = "same";
+    bool finished = r.status != "timeout" && r.status != "crashed";
+    bool base_finished = base.status != "timeout" && base.status != "crashed";
+    if (!finished && base_finished) {
+      verdict = r.status == "crashed" ? "REGRESSION (crashed)"
+                                      : "REGRESSION (timeout)";
+    } else if (finished && base_finished && r.matches != base.matches) {
+      verdict = "MISMATCH";
+    } else if (finished && !base_finished) {
+      verdict = "faster (finishes now)";
+    } else if (change > tolerance && ms - base_ms > min_delta_ms) {
+      verdict = "REGRESSION";
+    } else if (change < -tolerance && base_ms - ms > min_delta_ms) {
+      verdict = "faster";
+    }
+    if (strncmp(verdict, "REGRESSION", 10) == 0 ||
+        strcmp(verdict, "MISMATCH") == 0)
+      ++regressions;
+    std::cout << r.name << "\t" << base_ms << "\t" << ms << "\t"
+              << (change >= 0 ? "+" : "") << change * 100 << "%\t" << verdict;
+    // the same work should find the same tree
+    if (r.nodes != base.nodes)
+      std::cout << " (nodes " << base.nodes << " -> " << r.nodes << ")";
+    std::cout << "\n";
+  }
+  return regressions;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::string root = ".";
+  std::string filter;
+  std::string json_file_name, csv_file_name, baseline_file_name;
+  size_t runs = 3;
+  size_t num_threads = 1;
+  bool count_only = false;
+  double tolerance = 0.1;
+  double min_delta_ms = 1;
+  MatchOptions options;
+  options.time_budget_ms = 10000;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--root" && i + 1 < argc) {
+      root = argv[++i];
+    } else if (arg == "--filter" && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (arg == "-r" && i + 1 < argc) {
+      runs = std::max<size_t>(std::stoul(argv[++i]), 1);
+    } else if (arg == "--threads" && i + 1 < argc) {
+      num_threads = std::stoul(argv[++i]);
+    } else if (arg == "--limit" && i + 1 < argc) {
+      options.limit = std::stoul(argv[++i]);
+    } else if (arg == "--time-budget" && i + 1 < argc) {
+      options.time_budget_ms = std::stod(argv[++i]);
+    } else if (arg == "--failing-sets") {
+      options.failing_sets = true;
+    } else if (arg == "--count") {
+      count_only = true;
+    } else if (arg == "--json" && i + 1 < argc) {
+      json_file_name = argv[++i];
+    } else if (arg == "--csv" && i + 1 < argc) {
+      csv_file_name = argv[++i];
+    } else if (arg == "--compare" && i + 1 < argc) {
+      baseline_file_name = argv[++i];
+    } else if (arg == "--tolerance" && i + 1 < argc) {
+      tolerance = std::stod(argv[++i]) / 100;
+    } else {
+      std::cerr << "Usage: ./suite_bench [--root DIR] [--filter TEXT] "
+                   "[-r runs] [--threads N] [--limit N] [--time-budget MS] "
+                   "[--failing-sets] [--count] [--json FILE] [--csv FILE] "
+                   "[--compare BASELINE_CSV] [--tolerance PERCENT]\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::vector<Workload> workloads = FindWorkloads(root, filter);
+  if (workloads.empty()) {
+    std::cerr << "No workload found under " << root << "\n";
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "workload\tload ms\tsetup ms\tsearch ms\tfirst ms\tnodes\t"
+               "matches\tstatus\tpeak RSS KB\n";
+  std::vector<Result> results;
+  for (const Workload& w : workloads) {
+    Result r = Measure(w, runs, num_threads, options, count_only);
+    std::cout << r.name << "\t" << r.load_ms << "\t" << r.setup_ms << "\t"
+              << r.search_ms << "\t" << r.first_match_ms << "\t" << r.nodes
+              << "\t" << r.matches << "\t" << r.status << "\t"
+              << r.peak_rss_kb << std::endl;
+    results.push_back(r);
+  }
+
+  if (!csv_file_name.empty()) {
+    std::ofstream out(csv_file_name);
+    WriteCsv(results, out);
+  }
+  if (!json_file_name.empty()) {
+    std::ofstream out(json_file_name);
+    WriteJson(results, num_threads, options, out);
+  }
+
+  if (!baseline_file_name.empty()) {
+    std::map<std::string, Result> baseline = ReadCsv(baseline_file_name);
+    if (baseline.empty()) {
+      std::cerr << "Baseline " << baseline_file_name << " is not a CSV of "
+                << "suite_bench!\n";
+      return EXIT_FAILURE;
+    }
+    size_t regressions = Compare(results, baseline, tolerance, min_delta_ms);
+    std::cout << regressions << " regression(s) against "
+              << baseline_file_name << "\n";
+    if (regressions > 0) return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,28 @@
+#!/bin/bash
+# Thread scaling benchmark on the bundled _n8 and _s8 workloads.
+#
+# Usage: bench/thread_scaling.sh <program> [thread counts...]
+#   e.g. bench/thread_scaling.sh build/main/program 1 2 4 8 16 32
+#
+# Prints the wall-clock time (ms) and the number of matches of each run.
+# Set TIMEOUT (seconds, default 300) to bound a single run.
+
+program=${1:?usage: $0 <program> [thread counts...]}
+shift
+threads=${@:-1 2 4 8 16 32}
+root=$(cd "$(dirname "$0")/.." && pwd)
+
+printf "%-16s %8s %10s %8s\n" query threads time_ms matches
+for query in "$root"/query/lcc_*_n8.igraph "$root"/query/lcc_*_s8.igraph; do
+  name=$(basename "$query" .igraph)
+  data="$root/data/${name%_*}.igraph"
+  cs="$root/candidate_set/$name.cs"
+  for t in $threads; do
+    start=$(date +%s%N)
+    matches=$(timeout "${TIMEOUT:-300}" "$program" "$data" "$query" "$cs" \
+              --threads "$t" | grep -c '^a')
+    end=$(date +%s%N)
+    printf "%-16s %8s %10s %8s\n" "$name" "$t" $(((end - start) / 1000000)) \
+           "$matches"
+  done
+done
@@ -0,0 +1,124 @@
+/**
+ * @file arena.h
+ *
+ */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include "common.h"
+
+#include <new>
+
+/**
+ * @brief Bump allocator: allocations are carved out of large heap blocks and
+ * never freed one by one, only all at once by Reset(). Reset() keeps one
+ * block as large as everything allocated since the previous Reset(), so an
+ * arena that serves the same kind of work over and over stops taking memory
+ * from the heap after the first round.
+ */
+class Arena {
+ public:
+  static constexpr size_t kDefaultBlockSize = 1 << 16;
+
+  explicit Arena(size_t block_size = kDefaultBlockSize);
+  ~Arena();
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  void* AllocateBytes(size_t size, size_t alignment);
+  template <typename T>
+  inline T* Allocate(size_t n);
+  void Reset();
+
+  inline size_t GetNumAllocations() const;
+  inline size_t GetNumBytes() const;
+  inline size_t GetNumHeapBlocks() const;
+
+ private:
+  void AddBlock(size_t min_size);
+
+  size_t block_size_;
+  std::vector<std::pair<char*, size_t>> blocks_;  // the last one is in use
+  char* cursor_ = nullptr;
+  char* end_ = nullptr;
+  // since the last Reset()
+  size_t num_allocations_ = 0;
+  size_t num_bytes_ = 0;
+  size_t num_heap_blocks_ = 0;
+};
+
+/**
+ * @brief Returns uninitialized room for n objects of type T, valid until the
+ * next Reset().
+ *
+ * @param n
+ * @return T*
+ */
+template <typename T>
+inline T* Arena::Allocate(size_t n) {
+  return static_cast<T*>(AllocateBytes(n * sizeof(T), alignof(T)));
+}
+
+/**
+ * @brief Returns the number of allocations since the last Reset().
+ *
+ * @return size_t
+ */
+inline size_t Arena::GetNumAllocations() const { return num_allocations_; }
+/**
+ * @brief Returns the number of bytes allocated since the last Reset().
+ *
+ * @return size_t
+ */
+inline size_t Arena::GetNumBytes() const { return num_bytes_; }
+/**
+ * @brief Returns the number of blocks taken from the heap since the last
+ * Reset(), 0 when everything fit in the block kept by Reset().
+ *
+ * @return size_t
+ */
+inline size_t Arena::GetNumHeapBlocks() const { return num_heap_blocks_; }
+
+/**
+ * @brief Standard allocator over an Arena, so that containers can live in
+ * one; deallocate() leaves the memory to Arena::Reset(). Without an arena it
+ * allocates from the heap like std::allocator.
+ */
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+
+  explicit ArenaAllocator(Arena* arena = nullptr) : arena_(arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.GetArena()) {}
+
+  T* allocate(size_t n) {
+    if (arena_ != nullptr) return arena_->Allocate<T>(n);
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+  void deallocate(T* p, size_t) {
+    if (arena_ == nullptr) ::operator delete(p);
+  }
+
+  Arena* GetArena() const { return arena_; }
+
+ private:
+  Arena* arena_;
+};
+
+template <typename T, typename U>
+inline bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return a.GetArena() == b.GetArena();
+}
+template <typename T, typename U>
+inline bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return a.GetArena() != b.GetArena();
+}
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif  // ARENA_H_
@@ -6,68 +6,217 @@
 #ifndef BACKTRACK_H_
 #define BACKTRACK_H_
 
+#include "arena.h"
 #include "candidate_set.h"
+#include "candidate_space.h"
+#include "checkpoint.h"
 #include "common.h"
+#include "dag.h"
 #include "graph.h"
+#include "match_options.h"
+#include "perf_counters.h"
+#include "plan_cache.h"
+#include "result_sink.h"
+#include "search_profile.h"
+#include "symmetry.h"
+#include "task_queue.h"
 
-#include <unordered_map>
-
-class DAGNode {
-  private:
-    std::vector<Vertex> parent;
-    std::vector<Vertex> descendant;
-  public:
-    inline bool IsRoot() const {
-      return parent.empty();
-    }
-      
-    inline std::vector<Vertex> GetParent() {
-      return parent;
-    }
-      
-    inline void SetParent(Vertex p) {
-      parent.push_back(p);
-      return;
-    }
-      
-    inline std::vector<Vertex> GetDescendant() {
-      return descendant;
-    }
-      
-    inline void SetDescendant(Vertex d) {
-      descendant.push_back(d);
-      return;
-    }
-      
-    inline bool IsEmpty() {
-      return parent.empty() && descendant.empty();
-    }
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+// search state owned by one worker
+struct SearchState {
+  std::vector<Vertex> result;   // data vertex mapped to each query vertex
+  std::vector<size_t> position; // its position in the candidate set
+  std::vector<uint64_t> visited; // bitset of the data vertices already mapped
+  std::vector<size_t> unmappedParents;
+  // bitset of the unmapped core vertices whose parents are all mapped, the
+  // ones getNext chooses from
+  std::vector<uint64_t> ready;
+  // candidate positions adjacent to every mapped parent, per query vertex,
+  // valid once all of its parents are mapped
+  std::vector<std::vector<uint32_t>> extendable;
+  std::vector<size_t> extendableSize;
+  std::vector<uint32_t> scratch; // second buffer for the intersections
+  std::vector<Vertex> order;    // query vertex matched at each depth
+  std::vector<size_t> progress;
+  std::vector<size_t> limit;
+  std::vector<Vertex> batch;    // buffered embeddings for the sink
+  // leaves in the order they are enumerated, with their free candidates
+  std::vector<std::pair<size_t, Vertex>> leafOrder;
+  // failing sets (DAF) per depth: the union of the failing sets of the
+  // children tried so far, numWords words each, and whether a child led
+  // to a match
+  std::vector<uint64_t> failing;
+  std::vector<uint8_t> succeeded;
+  size_t nodes = 0;             // query vertices mapped
+  SearchProfile profile;        // counted in SEARCH_PROFILE builds only
+  size_t pollCountdown = 0;     // search steps until the next abort check
+};
+
+// leaves of the query with the same parent and label and the same
+// candidates, interchangeable in an embedding
+struct LeafBlock {
+  size_t begin;        // range in Backtrack::leaves
+  size_t end;
+  bool lastOfLabel;    // the next block has another label
 };
 
 class Backtrack {
-  int successCount = 0;
+  std::atomic<size_t> successCount{0};
+  std::atomic<bool> stop{false};
+  std::atomic<int> stopStatus{0}; // MatchStatus once stopped
+  std::atomic<int> idleWorkers{0};
+  size_t numThreads;
+  std::vector<SearchState> states; // one per worker, kept across queries
+  std::mutex outputMutex;
+  ResultSink* sink = nullptr;      // of the running query
+  const Vertex* originalIds = nullptr; // of a reordered data graph
+  bool emitEmbeddings = true;
+  size_t matchLimit = 100000;
+  const std::atomic<bool>* cancel = nullptr;
+  const std::atomic<bool>* suspend = nullptr;
+  // what the workers had not searched when the search was suspended
+  std::mutex pendingMutex;
+  std::vector<SearchTask> pending;
+  bool hasDeadline = false;
+  std::chrono::steady_clock::time_point deadline;
+  std::chrono::steady_clock::time_point firstMatch; // set by whoever finds it
+  bool failingSets = false;
+  // length of the query vertex bitsets, rounded up to 1, 2 or 4 words for
+  // the search kernels specialized on it
+  size_t numWords = 0;
+  std::vector<uint64_t> ancestors; // per query vertex, itself included
+  // degree-one query vertices left out of the search and matched once the
+  // rest of the query, the core, is
+  std::vector<uint8_t> isLeaf;
+  std::vector<Vertex> leaves;      // sorted by label and parent
+  std::vector<LeafBlock> leafBlocks;
+  // blocks hanging off each core vertex, in leafBlocksByParent[
+  // leafBlockOffset[u], leafBlockOffset[u + 1])
+  std::vector<size_t> leafBlockOffset;
+  std::vector<size_t> leafBlocksByParent;
+  size_t numCore = 0;
+  SymmetryBreaker querySymmetry;   // of a query without a plan cache
+  const SymmetryBreaker* symmetry = nullptr; // of the running query
+  Arena arena;                     // of the running query, reset after it
+  SearchProfile profile;           // of the last query, workers merged
+  // of a pulled search: where it stopped, and the embedding handed out
+  bool iterationStarted = false;
+  bool iterationDone = true;
+  size_t iterationDepth = 0;
+  size_t iterationRootBegin = 0;
+  size_t iterationRootEnd = SIZE_MAX;
+  std::vector<Vertex> iterationRow;
  public:
-  Backtrack();
+  explicit Backtrack(size_t numThreads = 1);
   ~Backtrack();
 
-  void PrintAllMatches(const Graph &data, const Graph &query,
-                       CandidateSet &cs);
-  
-  int buildMatchingArray(const Graph& query, CandidateSet& cs,
-                       std::unordered_map<Vertex, Vertex>& vtxConvMap,
-                       std::unordered_map<Vertex, Vertex>& vtxRevConvMap,
-                       std::vector<int>& matchingArray, std::vector<int>& visitedMap);
+  size_t PrintAllMatches(const Graph &data, const Graph &query,
+                         CandidateSet &cs);
+
+  MatchStats Run(const Graph &data, const Graph &query, const CandidateSet &cs,
+                 const MatchOptions &options, ResultSink &sink);
+
+  const SearchProfile& GetProfile() const { return profile; }
+
+  // pulled search for MatchIterator, on one worker: dag and space are built
+  // for the query, which is matched as a whole, without leaves or
+  // symmetries taken apart, and nextMatch hands out one embedding at a time
+  // in the ids of the data graph file, until it returns null
+  void beginIteration(const Graph &data, const Graph &query,
+                      const CandidateSet &cs, DAG& dag, CandidateSpace& space,
+                      const MatchOptions &options);
+  const Vertex* nextMatch(const CandidateSet &cs, const DAG& dag,
+                          const CandidateSpace& space);
+  void endIteration(const DAG& dag);
+  MatchStatus iterationStatus() const {
+    return static_cast<MatchStatus>(stopStatus.load());
+  }
+  size_t iterationNodes() const { return states[0].nodes; }
+
+  template <size_t W>
+  Vertex getNext(SearchState& state);
+
+  // W is numWords, or 0 for a kernel that reads it at run time
+  template <size_t W>
+  void doCheck(const Graph &data, const CandidateSet &cs,
+             const DAG& dag, const CandidateSpace& space,
+             SearchState& state, const SearchTask& task, TaskQueue& queue,
+             size_t workerId);
+
+ private:
+  template <size_t W>
+  void openDepth(SearchState& state, size_t depth, size_t begin, size_t end);
+  // searches on from depth until the task is done, or with yieldMatches
+  // until the core is mapped, and returns true then
+  template <size_t W>
+  bool searchLoop(const CandidateSet &cs, const DAG& dag,
+                  const CandidateSpace& space, SearchState& state,
+                  size_t taskDepth, size_t& depthRef, TaskQueue* queue,
+                  size_t workerId, bool yieldMatches);
+  template <size_t W>
+  bool resumeSearch(const CandidateSet &cs, const DAG& dag,
+                    const CandidateSpace& space);
+
+  void configure(const Graph &data, const Graph &query, const DAG& dag,
+                 const MatchOptions &options,
+                 std::chrono::steady_clock::time_point start);
+  void initState(const Graph &data, const CandidateSet &cs, const DAG& dag,
+                 const CandidateSpace& space, SearchState& state);
+
+  size_t computeExtendable(const CandidateSet &cs, const CandidateSpace& space,
+                           const DAG& dag, SearchState& state, Vertex id);
+
+  void mapVertex(const CandidateSet &cs, const CandidateSpace& space,
+                 const DAG& dag, SearchState& state,
+                 Vertex id, size_t candiPos);
+
+  void unmapVertex(const DAG& dag, SearchState& state, Vertex id);
+
+  void computeAncestors(const DAG& dag);
+  template <size_t W>
+  void resetFailing(SearchState& state, size_t depth);
+  template <size_t W>
+  void addConflict(SearchState& state, size_t depth, Vertex candidate);
+  template <size_t W>
+  void backjump(SearchState& state, size_t depth);
+
+  void findLeaves(const Graph &query);
+  void groupLeaves(const Graph &query, const CandidateSet &cs, const DAG& dag);
+  bool leavesFit(const CandidateSet &cs, const CandidateSpace& space,
+                 SearchState& state, Vertex id, size_t candiPos);
+  template <size_t W>
+  bool isOrdered(SearchState& state, size_t depth, Vertex id, Vertex candidate);
+  size_t addMatches(size_t num);
+  size_t reportMatch(SearchState& state);
+  size_t enumerateLeaves(const CandidateSet &cs, const CandidateSpace& space,
+                         const DAG& dag, SearchState& state, size_t i);
+  size_t countLeaves(const CandidateSet &cs, const CandidateSpace& space,
+                     const DAG& dag, SearchState& state);
+  size_t countBlocks(const CandidateSet &cs, const CandidateSpace& space,
+                     const DAG& dag, SearchState& state, size_t b);
+  size_t countCombinations(const CandidateSet &cs, const CandidateSpace& space,
+                           const DAG& dag, SearchState& state, size_t b,
+                           const uint32_t* it, const uint32_t* end,
+                           size_t remaining);
 
-  void build(const Graph& graph, std::vector<DAGNode>& dag, std::vector<Vertex>& remains, size_t pointer);
+  bool trySplit(SearchState& state, size_t taskDepth, size_t depth,
+                TaskQueue& queue, size_t workerId);
 
-  Vertex getNext(std::vector<Vertex>& result, std::vector<DAGNode>& dag, std::vector<Vertex>& order);
+  void runWorker(const Graph &data, const CandidateSet &cs,
+                 const DAG& dag, const CandidateSpace& space,
+                 TaskQueue& queue, size_t workerId);
 
-  void buildOrder(std::vector<Vertex>& result, std::vector<DAGNode>& dag, std::vector<Vertex>& order, Vertex start);
+  void flushOutput(SearchState& state);
 
-  void doCheck(const Graph &data, const CandidateSet &cs, std::vector<Vertex>& result,
-             std::vector<DAGNode>& dag, const std::vector<Vertex>& order,
-             std::vector<int> visitedMap, std::unordered_map<Vertex, Vertex> vtxRevConvMap,
-             std::vector<int> matchingArray, int acc);
+  void stopSearch(MatchStatus status);
+  bool shouldAbort();
+  inline bool isSuspended() const {
+    return suspend != nullptr && suspend->load(std::memory_order_relaxed);
+  }
+  void suspendTask(SearchState& state, size_t taskDepth, size_t depth);
 };
 
 #endif  // BACKTRACK_H_
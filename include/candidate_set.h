@@ -8,17 +8,32 @@
 
 #include "common.h"
 
+class DAG;
+class Graph;
+
 class CandidateSet {
  public:
   explicit CandidateSet(const std::string& filename);
+  CandidateSet(const std::string& filename, const Graph& data);
+  CandidateSet(const Graph& data, const Graph& query, size_t refine_steps = 5);
   ~CandidateSet();
 
   inline size_t GetCandidateSize(Vertex u) const;
   inline Vertex GetCandidate(Vertex u, size_t i) const;
   inline void SetCandidate(Vertex u, size_t i, Vertex v);
 
+  uint64_t ComputeFingerprint() const;
+
  private:
-  std::vector<std::vector<Vertex>> cs_;
+  void FilterByNeighborhood(const Graph& data, const Graph& query);
+  bool RefineByDAG(const Graph& data, const Graph& query, const DAG& dag,
+                   bool bottom_up);
+
+  // candidates of u in candidates_[offset_[u], offset_[u] + size_[u]), all
+  // query vertices in one buffer
+  std::vector<size_t> offset_;
+  std::vector<size_t> size_;
+  std::vector<Vertex> candidates_;
 };
 
 /**
@@ -29,7 +44,7 @@ class CandidateSet {
  * @return size_t
  */
 inline size_t CandidateSet::GetCandidateSize(Vertex u) const {
-  return cs_[u].size();
+  return size_[u];
 }
 /**
  * @brief Returns the i-th candidate from query vertex u's candidate set.
@@ -39,10 +54,10 @@ inline size_t CandidateSet::GetCandidateSize(Vertex u) const {
  * @return Vertex
  */
 inline Vertex CandidateSet::GetCandidate(Vertex u, size_t i) const {
-  return cs_[u][i];
+  return candidates_[offset_[u] + i];
 }
 
 inline void CandidateSet::SetCandidate(Vertex u, size_t i, Vertex v)  {
-  cs_[u][i] = v;
+  candidates_[offset_[u] + i] = v;
 }
 #endif  // CANDIDATE_SET_H_
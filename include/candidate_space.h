@@ -0,0 +1,91 @@
+/**
+ * @file candidate_space.h
+ *
+ */
+
+#ifndef CANDIDATE_SPACE_H_
+#define CANDIDATE_SPACE_H_
+
+#include "arena.h"
+#include "candidate_set.h"
+#include "common.h"
+#include "dag.h"
+#include "graph.h"
+
+/**
+ * @brief Candidate-space adjacency index (CS of DAF).
+ *
+ * For every DAG edge (parent p -> child u) and every candidate C(p)[i], it
+ * keeps the sorted list of positions j in C(u) such that C(p)[i] and C(u)[j]
+ * are adjacent in the data graph. Memory grows with the number of such edges
+ * instead of the square of the number of distinct candidates. Rebuilding an
+ * instance reuses its buffers. Given an arena, it keeps them there.
+ */
+class CandidateSpace {
+ public:
+  explicit CandidateSpace(Arena* arena = nullptr);
+  ~CandidateSpace();
+
+  void Build(const Graph& data, const Graph& query, const CandidateSet& cs,
+             const DAG& dag);
+
+  inline size_t GetNumParents(Vertex u) const;
+
+  inline const uint32_t* GetNeighborBegin(Vertex u, size_t k, size_t i) const;
+  inline const uint32_t* GetNeighborEnd(Vertex u, size_t k, size_t i) const;
+
+  inline size_t GetNumEdges() const;
+
+ private:
+  // edges of child u are [edge_offset_[u], edge_offset_[u + 1]), in the same
+  // order as DAG::GetParent()
+  ArenaVector<size_t> edge_offset_;
+  // lists of edge e are [list_base_[e], list_base_[e] + |C(parent)|] in
+  // list_offset_
+  ArenaVector<size_t> list_base_;
+  ArenaVector<size_t> list_offset_;
+  ArenaVector<uint32_t> list_;
+};
+
+/**
+ * @brief Returns the number of DAG parents of query vertex u.
+ *
+ * @param u query vertex id.
+ * @return size_t
+ */
+inline size_t CandidateSpace::GetNumParents(Vertex u) const {
+  return edge_offset_[u + 1] - edge_offset_[u];
+}
+/**
+ * @brief Returns the first position in C(u) adjacent to the i-th candidate of
+ * the k-th DAG parent of u.
+ *
+ * @param u query vertex id.
+ * @param k index of the parent in half-open interval [0, GetNumParents(u)).
+ * @param i index in the parent's candidate set.
+ * @return const uint32_t*
+ */
+inline const uint32_t* CandidateSpace::GetNeighborBegin(Vertex u, size_t k,
+                                                        size_t i) const {
+  return list_.data() + list_offset_[list_base_[edge_offset_[u] + k] + i];
+}
+/**
+ * @brief Returns the end of the position list of GetNeighborBegin(u, k, i).
+ *
+ * @param u query vertex id.
+ * @param k index of the parent in half-open interval [0, GetNumParents(u)).
+ * @param i index in the parent's candidate set.
+ * @return const uint32_t*
+ */
+inline const uint32_t* CandidateSpace::GetNeighborEnd(Vertex u, size_t k,
+                                                      size_t i) const {
+  return list_.data() + list_offset_[list_base_[edge_offset_[u] + k] + i + 1];
+}
+/**
+ * @brief Returns the total number of candidate-space edges.
+ *
+ * @return size_t
+ */
+inline size_t CandidateSpace::GetNumEdges() const { return list_.size(); }
+
+#endif  // CANDIDATE_SPACE_H_
@@ -0,0 +1,42 @@
+/**
+ * @file checkpoint.h
+ *
+ */
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include "candidate_set.h"
+#include "common.h"
+#include "graph.h"
+#include "match_options.h"
+#include "task_queue.h"
+
+/**
+ * @brief What a suspended search had left to do: the subtrees of the search
+ * tree it had not searched, as tasks, and the number of matches it had
+ * reported. A search resumed from it reports the other matches, none of the
+ * earlier ones again, provided it has the same plan; the data graph, query,
+ * candidate set and plan options it was taken with are kept to check that.
+ *
+ * A few hundred bytes for most searches: a task per depth of every worker
+ * and per task queued, each with the positions of the vertices above it.
+ */
+struct Checkpoint {
+  uint64_t data_fingerprint = 0;
+  uint64_t query_fingerprint = 0;
+  uint64_t candidate_fingerprint = 0;
+  uint32_t plan_options = 0;  // leaf decomposition, symmetry breaking
+  uint64_t num_matches = 0;   // reported before the checkpoint
+  std::vector<SearchTask> tasks;
+
+  void SetSearch(const Graph& data, const Graph& query, const CandidateSet& cs,
+                 const MatchOptions& options);
+  bool IsSearch(const Graph& data, const Graph& query, const CandidateSet& cs,
+                const MatchOptions& options) const;
+
+  bool Save(const std::string& filename) const;
+  bool Load(const std::string& filename);
+};
+
+#endif  // CHECKPOINT_H_
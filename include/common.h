@@ -19,4 +19,19 @@
 using Vertex = int32_t;
 using Label = int32_t;
 
+/**
+ * @brief Mixes value into the hash seed (the splitmix64 finalizer), for
+ * fingerprints of graphs and candidate sets.
+ *
+ * @param seed
+ * @param value
+ * @return uint64_t
+ */
+inline uint64_t HashCombine(uint64_t seed, uint64_t value) {
+  uint64_t x = seed + 0x9e3779b97f4a7c15ULL + value * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
 #endif  // COMMON_H_
@@ -0,0 +1,133 @@
+/**
+ * @file continuous_matcher.h
+ *
+ */
+
+#ifndef CONTINUOUS_MATCHER_H_
+#define CONTINUOUS_MATCHER_H_
+
+#include "common.h"
+#include "dynamic_graph.h"
+#include "graph.h"
+
+#include <functional>
+
+/**
+ * @brief What an edge update did to the embeddings of the queries.
+ */
+struct UpdateStats {
+  bool applied = false;    // false if the graph did not change
+  size_t num_matches = 0;  // embeddings created or destroyed, all queries
+  size_t num_nodes = 0;    // query vertices mapped by the searches
+  bool truncated = false;  // the limit stopped the searches
+};
+
+/**
+ * @brief Continuous subgraph matching: queries registered over a data graph
+ * that changes one edge at a time. Each update reports only the embeddings
+ * it creates or destroys, found by searches seeded with the updated edge
+ * mapped to each query edge of the same labels, in both directions. An
+ * embedding maps distinct query edges to distinct data edges, so each one
+ * is found by exactly one seed.
+ *
+ * The candidates of every query vertex, by label, degree and neighbor label
+ * frequency, are kept up to date; an update only changes those of its two
+ * endpoints. The vertices are those of the Graph the matcher was made from.
+ */
+class ContinuousMatcher {
+ public:
+  // the query's id, true for an embedding the update created and false for
+  // one it destroyed, the embedding in query vertex id order, and the number
+  // of query vertices
+  using Callback = std::function<void(size_t, bool, const Vertex*, size_t)>;
+
+  explicit ContinuousMatcher(const Graph& data, size_t limit = SIZE_MAX);
+
+  ContinuousMatcher(const ContinuousMatcher&) = delete;
+  ContinuousMatcher& operator=(const ContinuousMatcher&) = delete;
+
+  size_t AddQuery(const Graph& query);
+
+  UpdateStats InsertEdge(Vertex v, Vertex w,
+                         const Callback& callback = nullptr);
+  UpdateStats DeleteEdge(Vertex v, Vertex w,
+                         const Callback& callback = nullptr);
+
+  inline const DynamicGraph& GetGraph() const;
+  inline size_t GetNumQueries() const;
+  size_t GetNumCandidates(size_t query, Vertex u) const;
+
+ private:
+  // a matching order of a query starting with the two endpoints of a query
+  // edge, the ones the updated edge is mapped to
+  struct SeedOrder {
+    std::vector<Vertex> order;
+    // query vertex mapped before, whose image's neighbors are the
+    // candidates at each depth; -1 for every vertex of the label
+    std::vector<Vertex> parent;
+    // the other query vertices mapped before and adjacent to the one at
+    // depth d, in check[check_offset[d], check_offset[d + 1])
+    std::vector<size_t> check_offset;
+    std::vector<Vertex> check;
+  };
+
+  struct Query {
+    size_t num_vertices = 0;
+    std::vector<Label> label;
+    std::vector<size_t> degree;
+    // labels of the neighbors of u, with how many neighbors have each, in
+    // nlf[nlf_offset[u], nlf_offset[u + 1])
+    std::vector<size_t> nlf_offset;
+    std::vector<std::pair<Label, size_t>> nlf;
+    // bitset of the data vertices u may be mapped to, num_words_ words per
+    // query vertex
+    std::vector<uint64_t> candidate;
+    std::vector<SeedOrder> seeds;  // one per query edge and direction
+  };
+
+  static SeedOrder BuildSeedOrder(const Graph& query, Vertex first,
+                                  Vertex second);
+
+  bool Fits(const Query& query, Vertex u, Vertex v) const;
+  inline bool IsCandidate(const Query& query, Vertex u, Vertex v) const;
+  void UpdateCandidates(Vertex v);
+  bool HasEdge(Vertex v, Vertex w) const;
+
+  void Search(Vertex v, Vertex w, bool inserted, const Callback& callback,
+              UpdateStats& stats);
+  void Extend(size_t id, const SeedOrder& seed, size_t depth, bool inserted,
+              const Callback& callback, UpdateStats& stats);
+
+  DynamicGraph graph_;
+  size_t limit_;      // embeddings reported per update
+  size_t num_words_;  // of a bitset over the data vertices
+  std::vector<Query> queries_;
+  // of the running search: data vertex of each query vertex, and the data
+  // vertices mapped
+  std::vector<Vertex> embedding_;
+  std::vector<uint64_t> used_;
+};
+
+/**
+ * @brief Returns the data graph as of the last update.
+ *
+ * @return const DynamicGraph&
+ */
+inline const DynamicGraph& ContinuousMatcher::GetGraph() const {
+  return graph_;
+}
+/**
+ * @brief Returns the number of queries added.
+ *
+ * @return size_t
+ */
+inline size_t ContinuousMatcher::GetNumQueries() const {
+  return queries_.size();
+}
+
+inline bool ContinuousMatcher::IsCandidate(const Query& query, Vertex u,
+                                           Vertex v) const {
+  return (query.candidate[u * num_words_ + (v >> 6)] >> (v & 63)) & 1;
+}
+
+#endif  // CONTINUOUS_MATCHER_H_
@@ -0,0 +1,120 @@
+/**
+ * @file dag.h
+ *
+ */
+
+#ifndef DAG_H_
+#define DAG_H_
+
+#include "arena.h"
+#include "candidate_set.h"
+#include "common.h"
+#include "graph.h"
+
+/**
+ * @brief Query DAG, with the parents and the children of every query vertex
+ * in one CSR array. Rebuilding an instance reuses its buffers. Given an
+ * arena, it keeps them there.
+ */
+class DAG {
+ public:
+  explicit DAG(Arena* arena = nullptr);
+
+  void Build(const Graph& query, Vertex root);
+
+  inline size_t GetNumVertices() const;
+
+  inline bool IsRoot(Vertex u) const;
+  inline size_t GetNumParents(Vertex u) const;
+  inline Vertex GetParent(Vertex u, size_t k) const;
+  inline size_t GetNumChildren(Vertex u) const;
+  inline Vertex GetChild(Vertex u, size_t k) const;
+
+  inline const ArenaVector<Vertex>& GetOrder() const;
+
+ private:
+  // parents of u in adjacency_[offset_[2u], offset_[2u + 1]), children in
+  // adjacency_[offset_[2u + 1], offset_[2u + 2])
+  ArenaVector<size_t> offset_;
+  ArenaVector<Vertex> adjacency_;
+  ArenaVector<Vertex> order_;
+  ArenaVector<size_t> visit_index_;
+};
+
+/**
+ * @brief Returns the number of query vertices.
+ *
+ * @return size_t
+ */
+inline size_t DAG::GetNumVertices() const { return order_.size(); }
+
+/**
+ * @brief Returns true if u has no parent.
+ *
+ * @param u query vertex id.
+ * @return bool
+ */
+inline bool DAG::IsRoot(Vertex u) const {
+  return offset_[2 * u] == offset_[2 * u + 1];
+}
+/**
+ * @brief Returns the number of parents of u.
+ *
+ * @param u query vertex id.
+ * @return size_t
+ */
+inline size_t DAG::GetNumParents(Vertex u) const {
+  return offset_[2 * u + 1] - offset_[2 * u];
+}
+/**
+ * @brief Returns the k-th parent of u. Parents are in the order they were
+ * visited while building the DAG.
+ *
+ * @param u query vertex id.
+ * @param k
+ * @return Vertex
+ */
+inline Vertex DAG::GetParent(Vertex u, size_t k) const {
+  return adjacency_[offset_[2 * u] + k];
+}
+/**
+ * @brief Returns the number of children of u.
+ *
+ * @param u query vertex id.
+ * @return size_t
+ */
+inline size_t DAG::GetNumChildren(Vertex u) const {
+  return offset_[2 * u + 2] - offset_[2 * u + 1];
+}
+/**
+ * @brief Returns the k-th child of u.
+ *
+ * @param u query vertex id.
+ * @param k
+ * @return Vertex
+ */
+inline Vertex DAG::GetChild(Vertex u, size_t k) const {
+  return adjacency_[offset_[2 * u + 1] + k];
+}
+
+/**
+ * @brief Returns the query vertices in BFS order, a topological order of the
+ * DAG.
+ *
+ * @return const std::vector<Vertex>&
+ */
+inline const ArenaVector<Vertex>& DAG::GetOrder() const { return order_; }
+
+/**
+ * @brief Returns the query vertex minimizing |C(u)| / deg(u).
+ *
+ * @param query query graph.
+ * @param cs candidate set.
+ * @param excluded if given, the vertices u with (*excluded)[u] set are only
+ * chosen when every vertex is excluded.
+ * @return Vertex
+ */
+Vertex SelectRoot(const Graph& query, const CandidateSet& cs,
+                  const std::vector<uint8_t>* excluded = nullptr);
+
+#endif  // DAG_H_
@@ -0,0 +1,78 @@
+/**
+ * @file distributed_matcher.h
+ *
+ */
+
+#ifndef DISTRIBUTED_MATCHER_H_
+#define DISTRIBUTED_MATCHER_H_
+
+#include "candidate_set.h"
+#include "common.h"
+#include "graph.h"
+#include "match_options.h"
+#include "matcher.h"
+#include "plan_cache.h"
+#include "result_sink.h"
+
+/**
+ * @brief Subgraph matching spread over worker processes on one host. The
+ * coordinator plans the query, then forks the workers, which share its data
+ * graph, query and candidate set pages (and the mapping of a binary data
+ * graph) instead of loading their own, and start with the plan in their
+ * cache.
+ *
+ * The candidates of the root are handed out in slices over a socket per
+ * worker, large ones first and smaller ones as fewer remain, and a worker
+ * gets another slice whenever it finishes one. Workers send their matches
+ * back, and the coordinator alone writes to the sink, so that the match
+ * limit holds over all of them: a slice may find at most what is left of it,
+ * and the workers are killed once it is reached. The time budget and the
+ * cancellation flag apply to the whole search as well; the suspension flag
+ * and the checkpoints of MatchOptions do not. A search that lost a slice to a
+ * dead worker ends as MatchStatus::kFailed.
+ */
+class DistributedMatcher {
+ public:
+  explicit DistributedMatcher(size_t num_workers, size_t num_threads = 1);
+
+  DistributedMatcher(const DistributedMatcher&) = delete;
+  DistributedMatcher& operator=(const DistributedMatcher&) = delete;
+
+  MatchStats Run(const Graph& data, const Graph& query, const CandidateSet& cs,
+                 const MatchOptions& options, ResultSink& sink);
+
+  inline size_t GetNumSlices() const;
+  inline size_t GetNumLostSlices() const;
+
+ private:
+  // the loop of a worker process, which never returns
+  [[noreturn]] void Serve(int fd, const Graph& data, const Graph& query,
+                          const CandidateSet& cs, const MatchOptions& options,
+                          bool needs_embeddings);
+
+  size_t num_workers_;
+  size_t num_threads_;  // of the Matcher of every worker
+  // plans of the queries when MatchOptions has no cache
+  PlanCache plan_cache_;
+  size_t num_slices_ = 0;
+  size_t num_lost_slices_ = 0;
+};
+
+/**
+ * @brief Returns the number of slices of root candidates the last Run()
+ * handed out.
+ *
+ * @return size_t
+ */
+inline size_t DistributedMatcher::GetNumSlices() const { return num_slices_; }
+/**
+ * @brief Returns the number of slices of the last Run() whose worker died
+ * before finishing them; their matches are missing.
+ *
+ * @return size_t
+ */
+inline size_t DistributedMatcher::GetNumLostSlices() const {
+  return num_lost_slices_;
+}
+
+#endif  // DISTRIBUTED_MATCHER_H_
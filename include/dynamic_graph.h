@@ -0,0 +1,171 @@
+/**
+ * @file dynamic_graph.h
+ *
+ */
+
+#ifndef DYNAMIC_GRAPH_H_
+#define DYNAMIC_GRAPH_H_
+
+#include "common.h"
+#include "graph.h"
+
+/**
+ * @brief Data graph whose edges can be inserted and deleted, over the
+ * vertices and labels of a Graph. Every vertex keeps its own neighbor list,
+ * sorted by label and id like those of Graph, so that the neighbors with a
+ * label are a range and an update moves at most a degree's worth of ids.
+ */
+class DynamicGraph {
+ public:
+  explicit DynamicGraph(const Graph& graph);
+
+  bool InsertEdge(Vertex v, Vertex w);
+  bool DeleteEdge(Vertex v, Vertex w);
+
+  inline size_t GetNumVertices() const;
+  inline size_t GetNumEdges() const;
+  inline size_t GetNumLabels() const;
+
+  inline Label GetLabel(Vertex v) const;
+  inline size_t GetDegree(Vertex v) const;
+  inline bool IsNeighbor(Vertex v, Vertex w) const;
+
+  inline const Vertex* GetNeighborBegin(Vertex v) const;
+  inline const Vertex* GetNeighborEnd(Vertex v) const;
+  inline std::pair<const Vertex*, const Vertex*> GetNeighbors(Vertex v,
+                                                              Label l) const;
+
+  inline const Vertex* GetVertexBegin(Label l) const;
+  inline const Vertex* GetVertexEnd(Label l) const;
+
+ private:
+  // the place of w in a neighbor list, by label then id
+  inline bool Precedes(Vertex a, Vertex b) const;
+
+  size_t num_edges_;
+  std::vector<Label> label_;
+  std::vector<std::vector<Vertex>> adjacency_;
+  // vertices with label l in vertex_[vertex_offset_[l], vertex_offset_[l + 1])
+  std::vector<size_t> vertex_offset_;
+  std::vector<Vertex> vertex_;
+};
+
+/**
+ * @brief Returns the number of vertices |V| of the graph.
+ *
+ * @return size_t
+ */
+inline size_t DynamicGraph::GetNumVertices() const { return label_.size(); }
+/**
+ * @brief Returns the number of edges |E| of the graph.
+ *
+ * @return size_t
+ */
+inline size_t DynamicGraph::GetNumEdges() const { return num_edges_; }
+/**
+ * @brief Returns the number of label ids, those of the Graph it was made
+ * from.
+ *
+ * @return size_t
+ */
+inline size_t DynamicGraph::GetNumLabels() const {
+  return vertex_offset_.size() - 1;
+}
+
+/**
+ * @brief Returns the label of the vertex v.
+ *
+ * @param v vertex id.
+ * @return Label
+ */
+inline Label DynamicGraph::GetLabel(Vertex v) const { return label_[v]; }
+/**
+ * @brief Returns the degree of the vertex v.
+ *
+ * @param v vertex id.
+ * @return size_t
+ */
+inline size_t DynamicGraph::GetDegree(Vertex v) const {
+  return adjacency_[v].size();
+}
+
+inline bool DynamicGraph::Precedes(Vertex a, Vertex b) const {
+  return label_[a] < label_[b] || (label_[a] == label_[b] && a < b);
+}
+
+/**
+ * @brief Returns true if v and w are adjacent, searching the shorter of
+ * their neighbor lists.
+ *
+ * @param v vertex id.
+ * @param w vertex id.
+ * @return bool
+ */
+inline bool DynamicGraph::IsNeighbor(Vertex v, Vertex w) const {
+  if (adjacency_[v].size() > adjacency_[w].size()) std::swap(v, w);
+  const std::vector<Vertex>& neighbors = adjacency_[v];
+  auto it = std::lower_bound(
+      neighbors.begin(), neighbors.end(), w,
+      [this](Vertex a, Vertex b) { return Precedes(a, b); });
+  return it != neighbors.end() && *it == w;
+}
+
+/**
+ * @brief Returns the first neighbor of v; the neighbors are sorted by label,
+ * then id.
+ *
+ * @param v vertex id.
+ * @return const Vertex*
+ */
+inline const Vertex* DynamicGraph::GetNeighborBegin(Vertex v) const {
+  return adjacency_[v].data();
+}
+/**
+ * @brief Returns the end of the neighbors of v.
+ *
+ * @param v vertex id.
+ * @return const Vertex*
+ */
+inline const Vertex* DynamicGraph::GetNeighborEnd(Vertex v) const {
+  return adjacency_[v].data() + adjacency_[v].size();
+}
+/**
+ * @brief Returns the neighbors of v with label l, empty if there is none.
+ *
+ * @param v vertex id.
+ * @param l label id.
+ * @return std::pair<const Vertex*, const Vertex*>
+ */
+inline std::pair<const Vertex*, const Vertex*> DynamicGraph::GetNeighbors(
+    Vertex v, Label l) const {
+  const Vertex* begin = GetNeighborBegin(v);
+  const Vertex* end = GetNeighborEnd(v);
+  begin = std::lower_bound(begin, end, l, [this](Vertex w, Label label) {
+    return label_[w] < label;
+  });
+  end = std::upper_bound(begin, end, l, [this](Label label, Vertex w) {
+    return label < label_[w];
+  });
+  return std::make_pair(begin, end);
+}
+
+/**
+ * @brief Returns the first vertex with label l, in id order.
+ *
+ * @param l label id, in [0, GetNumLabels()).
+ * @return const Vertex*
+ */
+inline const Vertex* DynamicGraph::GetVertexBegin(Label l) const {
+  return vertex_.data() + vertex_offset_[l];
+}
+/**
+ * @brief Returns the end of the vertices with label l.
+ *
+ * @param l label id, in [0, GetNumLabels()).
+ * @return const Vertex*
+ */
+inline const Vertex* DynamicGraph::GetVertexEnd(Label l) const {
+  return vertex_.data() + vertex_offset_[l + 1];
+}
+
+#endif  // DYNAMIC_GRAPH_H_
@@ -7,13 +7,54 @@
 #define GRAPH_H_
 
 #include "common.h"
+#include "profile.h"
+
+// data vertices with at least this degree get an adjacency bitmap, but only
+// if the degree is also at least 1/64 of the number of vertices: a bitmap of
+// N bits then takes at most twice the bytes of the neighbor list it indexes,
+// which bounds the whole index by twice the adjacency array
+constexpr size_t kDefaultEdgeIndexThreshold = 64;
+
+/**
+ * @brief Orders the data vertices can be renumbered in, see Graph::Reorder().
+ * Both keep the vertices of a label together, so that a candidate set, and
+ * the neighbors of a vertex with a label, have nearby ids.
+ */
+enum class VertexOrder {
+  kOriginal,  // the ids of the file
+  kDegree,    // by label, then by descending degree
+  kBfs,       // by label, then in reverse Cuthill-McKee order
+};
+
+/**
+ * @brief Parses "none", "degree" or "bfs".
+ *
+ * @param name
+ * @param order set on success.
+ * @return bool
+ */
+bool ParseVertexOrder(const std::string& name, VertexOrder* order);
 
 class Graph {
  public:
-  explicit Graph(const std::string& filename, bool is_query = false);
+  explicit Graph(const std::string& filename,
+                 size_t edge_index_threshold = kDefaultEdgeIndexThreshold);
+  Graph(const std::string& filename, const Graph& data);
   ~Graph();
 
+  Graph(const Graph&) = delete;
+  Graph& operator=(const Graph&) = delete;
+
+  void Save(const std::string& filename) const;
+
+  void Reorder(VertexOrder order);
+  inline bool IsReordered() const;
+  inline Vertex GetOriginalId(Vertex v) const;
+  inline const Vertex* GetOriginalIds() const;
+  inline Vertex GetInternalId(Vertex original_id) const;
+
   inline int32_t GetGraphID() const;
+  inline uint64_t GetFingerprint() const;
 
   inline size_t GetNumVertices() const;
   inline size_t GetNumEdges() const;
@@ -35,22 +76,87 @@ class Graph {
 
   inline bool IsNeighbor(Vertex u, Vertex v) const;
 
+  inline size_t GetNumIndexedVertices() const;
+  inline bool HasDenseLabelIndex() const;
+  inline size_t GetLabelIndexBytes() const;
+
  private:
+  // a label segment of a vertex in the sparse index, begin is relative to the
+  // vertex's first neighbor
+  struct LabelSegment {
+    Label label;
+    uint32_t begin;
+  };
+
+  inline std::pair<size_t, size_t> GetLabelSegment(Vertex v, Label l) const;
+
   int32_t graph_id_;
+  // hash of the labels and the adjacency, the same for the same graph
+  // whatever its file's format or edge order; stored in a binary file, and
+  // computed on first use otherwise
+  mutable uint64_t fingerprint_ = 0;
+  mutable bool has_fingerprint_ = false;
 
   size_t num_vertices_;
   size_t num_edges_;
   size_t num_labels_;
 
-  std::vector<size_t> label_frequency_;
+  // the accessors read through these, which point either into the storage
+  // vectors below (text file) or into the mapped binary file
+  const size_t* label_frequency_;
+
+  const size_t* start_offset_;
 
-  std::vector<size_t> start_offset_;
-  std::vector<std::pair<size_t, size_t>> start_offset_by_label_;
+  // label segments of each vertex. The dense index keeps max_label_ + 2
+  // prefix counts per vertex, the sparse one a LabelSegment per label present,
+  // sorted by label, from label_segment_offset_[v] on
+  bool dense_label_index_;
+  const uint32_t* label_prefix_;
+  const size_t* label_segment_offset_;
+  const LabelSegment* label_segment_;
+  size_t num_label_segments_;
 
-  std::vector<Label> label_;
-  std::vector<Vertex> adj_array_;
+  const Label* label_;
+  const Vertex* adj_array_;
 
   Label max_label_;
+
+  // raw label of the data graph file -> label id, shared by its query graphs
+  const Label* transferred_label_;
+  size_t num_transferred_labels_;
+
+  std::vector<size_t> label_frequency_storage_;
+  std::vector<size_t> start_offset_storage_;
+  std::vector<uint32_t> label_prefix_storage_;
+  std::vector<size_t> label_segment_offset_storage_;
+  std::vector<LabelSegment> label_segment_storage_;
+  std::vector<Label> label_storage_;
+  std::vector<Vertex> adj_array_storage_;
+  std::vector<Label> transferred_label_storage_;
+
+  // id in the file of every vertex, null unless reordered
+  const Vertex* original_id_ = nullptr;
+  std::vector<Vertex> original_id_storage_;
+  std::vector<Vertex> internal_id_;  // the inverse, empty unless reordered
+
+  void* mapped_ = nullptr;
+  size_t mapped_size_ = 0;
+
+  size_t edge_index_threshold_ = kDefaultEdgeIndexThreshold;
+
+  // adjacency bitmaps of the high-degree vertices, edge_bitmap_slot_[v] is
+  // the index of v's bitmap or UINT32_MAX
+  std::vector<uint32_t> edge_bitmap_slot_;
+  std::vector<uint64_t> edge_bitmap_;
+  size_t num_bitmap_words_ = 0;
+  size_t num_indexed_vertices_ = 0;
+
+  void BuildLabelIndex();
+  void BuildEdgeIndex(size_t degree_threshold);
+  void ComputeFingerprint() const;
+
+  void LoadText(const std::string& filename, const Graph* data);
+  void LoadBinary(const std::string& filename);
 };
 
 /**
@@ -59,6 +165,18 @@ class Graph {
  * @return int32_t
  */
 inline int32_t Graph::GetGraphID() const { return graph_id_; }
+/**
+ * @brief Returns a hash of the labels and the adjacency of the graph, which
+ * tells apart the data graphs a query plan was made for. Renumbering the
+ * vertices changes it. The first call on a text graph hashes the whole graph,
+ * so it is not to be made by several threads at once.
+ *
+ * @return uint64_t
+ */
+inline uint64_t Graph::GetFingerprint() const {
+  if (!has_fingerprint_) ComputeFingerprint();
+  return fingerprint_;
+}
 
 /**
  * @brief Returns the number of vertices |V| of the graph.
@@ -96,7 +214,8 @@ inline size_t Graph::GetLabelFrequency(Label l) const {
  * @return size_t
  */
 inline size_t Graph::GetNeighborLabelFrequency(Vertex v, Label l) const {
-  return GetNeighborEndOffset(v, l) - GetNeighborStartOffset(v, l);
+  std::pair<size_t, size_t> segment = GetLabelSegment(v, l);
+  return segment.second - segment.first;
 }
 /**
  * @brief Returns the degree of the vertex v.
@@ -135,7 +254,7 @@ inline size_t Graph::GetNeighborEndOffset(Vertex v) const {
  * @return size_t
  */
 inline size_t Graph::GetNeighborStartOffset(Vertex v, Label l) const {
-  return start_offset_by_label_[v * (max_label_ + 1) + l].first;
+  return GetLabelSegment(v, l).first;
 }
 /**
  * @brief Returns the end offset of the neighbor of v with label l. If there is
@@ -146,7 +265,45 @@ inline size_t Graph::GetNeighborStartOffset(Vertex v, Label l) const {
  * @return size_t
  */
 inline size_t Graph::GetNeighborEndOffset(Vertex v, Label l) const {
-  return start_offset_by_label_[v * (max_label_ + 1) + l].second;
+  return GetLabelSegment(v, l).second;
+}
+
+/**
+ * @brief Returns the offsets [start, end) of the neighbors of v with label l
+ * in the adjacent array, or (0, 0) if there is none.
+ *
+ * @param v vertex id.
+ * @param l label of v's neighbor.
+ * @return std::pair<size_t, size_t>
+ */
+inline std::pair<size_t, size_t> Graph::GetLabelSegment(Vertex v,
+                                                        Label l) const {
+  if (l < 0 || l > max_label_) return std::make_pair(0, 0);
+
+  size_t start = start_offset_[v];
+  if (dense_label_index_) {
+    const uint32_t* prefix = label_prefix_ + v * (max_label_ + 2) + l;
+    if (prefix[0] == prefix[1]) return std::make_pair(0, 0);
+    return std::make_pair(start + prefix[0], start + prefix[1]);
+  }
+
+  const LabelSegment* first = label_segment_ + label_segment_offset_[v];
+  const LabelSegment* last = label_segment_ + label_segment_offset_[v + 1];
+  const LabelSegment* it = first;
+  // most vertices have a handful of neighbor labels, counted without branches
+  if (last - first <= 16) {
+    size_t below = 0;
+    for (const LabelSegment* s = first; s != last; ++s) below += s->label < l;
+    it = first + below;
+  } else {
+    it = std::lower_bound(
+        first, last, l,
+        [](const LabelSegment& s, Label label) { return s.label < label; });
+  }
+  if (it == last || it->label != l) return std::make_pair(0, 0);
+
+  size_t end = it + 1 != last ? start + (it + 1)->begin : start_offset_[v + 1];
+  return std::make_pair(start + it->begin, end);
 }
 
 /**
@@ -170,28 +327,100 @@ inline Vertex Graph::GetNeighbor(size_t offset) const {
 
 /**
  * @brief Returns true if there is an edge between u and v, otherwise return
- * false.
+ * false. Uses the adjacency bitmap of u or v if either has one, and otherwise
+ * a branch-free binary search in the shorter of the two id-sorted label
+ * segments.
  *
  * @param u vertex id.
  * @param v vertex id.
  * @return bool
  */
 inline bool Graph::IsNeighbor(Vertex u, Vertex v) const {
-  if (GetNeighborLabelFrequency(u, GetLabel(v)) >
-      GetNeighborLabelFrequency(v, GetLabel(u)))
+  PROFILE(++num_is_neighbor_calls);
+  if (!edge_bitmap_slot_.empty()) {
+    if (edge_bitmap_slot_[v] != UINT32_MAX) std::swap(u, v);
+    uint32_t slot = edge_bitmap_slot_[u];
+    if (slot != UINT32_MAX)
+      return (edge_bitmap_[slot * num_bitmap_words_ + (v >> 6)] >> (v & 63)) &
+             1;
+  }
+
+  std::pair<size_t, size_t> segment = GetLabelSegment(u, GetLabel(v));
+  std::pair<size_t, size_t> reverse = GetLabelSegment(v, GetLabel(u));
+  if (segment.second - segment.first > reverse.second - reverse.first) {
     std::swap(u, v);
-  auto it = std::lower_bound(
-      adj_array_.begin() + GetNeighborStartOffset(u, GetLabel(v)),
-      adj_array_.begin() + GetNeighborEndOffset(u, GetLabel(v)), v,
-      [this](Vertex u, Vertex v) {
-        if (GetDegree(u) != GetDegree(v))
-          return GetDegree(u) > GetDegree(v);
-        else
-          return u < v;
-      });
-  size_t offset = it - adj_array_.begin();
-  return offset >= GetNeighborStartOffset(u, GetLabel(v)) &&
-         offset < GetNeighborEndOffset(u, GetLabel(v)) && *it == v;
+    segment = reverse;
+  }
+
+  const Vertex* base = adj_array_ + segment.first;
+  size_t n = segment.second - segment.first;
+  if (n == 0) return false;
+  while (n > 1) {
+    size_t half = n / 2;
+    base = base[half] <= v ? base + half : base;
+    n -= half;
+  }
+  return *base == v;
+}
+/**
+ * @brief Returns true if the vertices were renumbered by Reorder(), now or
+ * before the graph was saved.
+ *
+ * @return bool
+ */
+inline bool Graph::IsReordered() const { return original_id_ != nullptr; }
+/**
+ * @brief Returns the id that v has in the graph file.
+ *
+ * @param v vertex id.
+ * @return Vertex
+ */
+inline Vertex Graph::GetOriginalId(Vertex v) const {
+  return original_id_ != nullptr ? original_id_[v] : v;
+}
+/**
+ * @brief Returns the ids in the graph file of all vertices, or null if the
+ * graph was not reordered.
+ *
+ * @return const Vertex*
+ */
+inline const Vertex* Graph::GetOriginalIds() const { return original_id_; }
+/**
+ * @brief Returns the id of the vertex that has original_id in the graph file.
+ *
+ * @param original_id
+ * @return Vertex
+ */
+inline Vertex Graph::GetInternalId(Vertex original_id) const {
+  return original_id_ != nullptr ? internal_id_[original_id] : original_id;
+}
+
+/**
+ * @brief Returns the number of vertices that have an adjacency bitmap.
+ *
+ * @return size_t
+ */
+inline size_t Graph::GetNumIndexedVertices() const {
+  return num_indexed_vertices_;
+}
+/**
+ * @brief Returns true if the label segments are kept in a dense table of one
+ * row of label offsets per vertex, which happens when the graph has at most
+ * 128 labels (max label + 1 <= kMaxDenseLabels in graph.cc).
+ *
+ * @return bool
+ */
+inline bool Graph::HasDenseLabelIndex() const { return dense_label_index_; }
+/**
+ * @brief Returns the memory taken by the label segment index.
+ *
+ * @return size_t
+ */
+inline size_t Graph::GetLabelIndexBytes() const {
+  if (dense_label_index_)
+    return sizeof(uint32_t) * num_vertices_ * (max_label_ + 2);
+  return sizeof(size_t) * (num_vertices_ + 1) +
+         sizeof(LabelSegment) * num_label_segments_;
 }
 
 #endif  // GRAPH_H_
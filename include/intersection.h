@@ -0,0 +1,47 @@
+/**
+ * @file intersection.h
+ *
+ */
+
+#ifndef INTERSECTION_H_
+#define INTERSECTION_H_
+
+#include "common.h"
+
+/**
+ * @brief Number of elements a kernel may write past the end of its result.
+ * Output buffers need this much slack after the largest possible result.
+ */
+constexpr size_t kIntersectionPadding = 8;
+
+enum class IntersectionKernel { kScalar, kSSE, kAVX2 };
+
+/**
+ * @brief Writes the intersection of the strictly increasing arrays a and b
+ * into out, which must not overlap a or b and must have room for
+ * min(na, nb) + kIntersectionPadding elements.
+ *
+ * @return size_t the number of common elements.
+ */
+size_t Intersect(const uint32_t* a, size_t na, const uint32_t* b, size_t nb,
+                 uint32_t* out);
+
+/**
+ * @brief Returns the kernel used by Intersect, the widest one the CPU
+ * supports unless overridden by SetIntersectionKernel.
+ *
+ * @return IntersectionKernel
+ */
+IntersectionKernel GetIntersectionKernel();
+
+/**
+ * @brief Forces a kernel, falling back to a narrower one if the CPU does not
+ * support it. Meant for benchmarks and cross-checking the kernels.
+ *
+ * @param kernel
+ */
+void SetIntersectionKernel(IntersectionKernel kernel);
+
+const char* GetIntersectionKernelName(IntersectionKernel kernel);
+
+#endif  // INTERSECTION_H_
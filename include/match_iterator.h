@@ -0,0 +1,92 @@
+/**
+ * @file match_iterator.h
+ *
+ */
+
+#ifndef MATCH_ITERATOR_H_
+#define MATCH_ITERATOR_H_
+
+#include "backtrack.h"
+#include "candidate_set.h"
+#include "candidate_space.h"
+#include "common.h"
+#include "dag.h"
+#include "graph.h"
+#include "match_options.h"
+
+/**
+ * @brief Pull-based subgraph matching: every Next() resumes the search where
+ * the previous one stopped and returns the next embedding, so that a
+ * consumer that stops after k embeddings pays for k, and memory does not
+ * grow with the number of embeddings.
+ *
+ * The search runs on the calling thread. Every query vertex is searched for,
+ * as the leaf decomposition and the symmetry breaking of Matcher find
+ * several embeddings at once; the failing sets, the match limit, the time
+ * budget (counted from the construction), the cancellation flag and the root
+ * range of MatchOptions apply. The data graph, the query and the candidate
+ * set must outlive the iterator.
+ */
+class MatchIterator {
+ public:
+  MatchIterator(const Graph& data, const Graph& query, const CandidateSet& cs,
+                const MatchOptions& options = MatchOptions());
+  ~MatchIterator();
+
+  MatchIterator(const MatchIterator&) = delete;
+  MatchIterator& operator=(const MatchIterator&) = delete;
+
+  const Vertex* Next();
+
+  inline size_t GetNumVertices() const;
+  inline size_t GetNumMatches() const;
+  inline size_t GetNumNodes() const;
+  inline bool IsDone() const;
+  inline MatchStatus GetStatus() const;
+
+ private:
+  const CandidateSet& cs_;
+  size_t num_vertices_;
+  size_t num_matches_ = 0;
+  bool done_ = false;
+  DAG dag_;
+  CandidateSpace space_;
+  Backtrack backtrack_;
+};
+
+/**
+ * @brief Returns the length of an embedding, the number of query vertices.
+ *
+ * @return size_t
+ */
+inline size_t MatchIterator::GetNumVertices() const { return num_vertices_; }
+/**
+ * @brief Returns the number of embeddings Next() returned.
+ *
+ * @return size_t
+ */
+inline size_t MatchIterator::GetNumMatches() const { return num_matches_; }
+/**
+ * @brief Returns the number of query vertices mapped so far.
+ *
+ * @return size_t
+ */
+inline size_t MatchIterator::GetNumNodes() const {
+  return backtrack_.iterationNodes();
+}
+/**
+ * @brief Returns true once Next() returned null.
+ *
+ * @return bool
+ */
+inline bool MatchIterator::IsDone() const { return done_; }
+/**
+ * @brief Returns why the search ended, once it has.
+ *
+ * @return MatchStatus
+ */
+inline MatchStatus MatchIterator::GetStatus() const {
+  return backtrack_.iterationStatus();
+}
+
+#endif  // MATCH_ITERATOR_H_
@@ -0,0 +1,101 @@
+/**
+ * @file match_options.h
+ *
+ */
+
+#ifndef MATCH_OPTIONS_H_
+#define MATCH_OPTIONS_H_
+
+#include "common.h"
+
+#include <atomic>
+
+class PlanCache;
+struct Checkpoint;
+
+/**
+ * @brief Why a search ended.
+ */
+enum class MatchStatus {
+  kExhausted,  // every embedding was found
+  kLimit,      // the match limit was reached
+  kTimeout,    // the time budget ran out
+  kCancelled,  // the cancellation flag was raised
+  kSuspended,  // the suspension flag was raised, the rest is in a checkpoint
+  kFailed,     // part of the search was lost, its embeddings are missing
+};
+
+/**
+ * @brief Limits of a search. The defaults are those of the challenge: at most
+ * 100000 matches and no time budget.
+ */
+struct MatchOptions {
+  size_t limit = 100000;      // maximum number of matches, SIZE_MAX for all
+  double time_budget_ms = 0;  // wall-clock budget, 0 for none
+  // polled while searching, the search stops soon after it becomes true
+  const std::atomic<bool>* cancel = nullptr;
+  bool first_match_only = false;  // same as a limit of 1
+  // prune with the failing sets of DAF, skipping the remaining candidates of
+  // a query vertex when a subtree failed for reasons unrelated to it
+  bool failing_sets = false;
+  // match the degree-one query vertices after the rest of the query, all
+  // interchangeable ones at once, and only count their assignments when the
+  // sink needs no embeddings
+  bool leaf_decomposition = true;
+  // search one embedding per orbit of the query's automorphisms and derive
+  // the others from it
+  bool symmetry_breaking = true;
+  // plans of the queries seen before, reused instead of planning the query
+  // again; none if null
+  PlanCache* plan_cache = nullptr;
+  // only the candidates of the root, the first query vertex matched, at
+  // positions [root_begin, root_end) are tried, so that disjoint ranges split
+  // the search; MatchStats::num_root_candidates tells how many there are
+  size_t root_begin = 0;
+  size_t root_end = SIZE_MAX;
+  // polled while searching like cancel, but the search then stops where it
+  // can go on from, and leaves what it had not searched in checkpoint
+  const std::atomic<bool>* suspend = nullptr;
+  Checkpoint* checkpoint = nullptr;
+  // searches only what a suspended search had left, counting its matches;
+  // Checkpoint::IsSearch() tells whether it fits the search
+  const Checkpoint* resume = nullptr;
+};
+
+/**
+ * @brief What a search did.
+ */
+struct MatchStats {
+  size_t num_matches = 0;
+  size_t num_nodes = 0;  // query vertices mapped over the whole search
+  double elapsed_ms = 0;
+  double setup_ms = 0;         // of elapsed_ms, before the search started
+  double first_match_ms = -1;  // since the start, -1 without a match
+  bool plan_cached = false;    // the plan came from MatchOptions::plan_cache
+  size_t num_root_candidates = 0;  // of the root, whatever the range tried
+  // buffers of the query's DAG, candidate space and symmetry breaking, all
+  // from one arena freed when the query ends
+  size_t arena_allocations = 0;
+  size_t arena_bytes = 0;
+  size_t heap_blocks = 0;  // the arena took from the heap, 0 once warm
+  MatchStatus status = MatchStatus::kExhausted;
+};
+
+inline const char* GetMatchStatusName(MatchStatus status) {
+  switch (status) {
+    case MatchStatus::kLimit:
+      return "limit";
+    case MatchStatus::kTimeout:
+      return "timeout";
+    case MatchStatus::kCancelled:
+      return "cancelled";
+    case MatchStatus::kSuspended:
+      return "suspended";
+    case MatchStatus::kFailed:
+      return "failed";
+    default:
+      return "exhausted";
+  }
+}
+
+#endif  // MATCH_OPTIONS_H_
@@ -0,0 +1,52 @@
+/**
+ * @file matcher.h
+ *
+ */
+
+#ifndef MATCHER_H_
+#define MATCHER_H_
+
+#include "backtrack.h"
+#include "candidate_set.h"
+#include "common.h"
+#include "graph.h"
+#include "match_options.h"
+#include "result_sink.h"
+#include "search_profile.h"
+
+/**
+ * @brief Library entry point for subgraph matching. A Matcher keeps its
+ * worker threads' buffers between queries, so one instance should serve many
+ * queries, one at a time.
+ */
+class Matcher {
+ public:
+  explicit Matcher(size_t num_threads = 1) : backtrack_(num_threads) {}
+
+  Matcher(const Matcher&) = delete;
+  Matcher& operator=(const Matcher&) = delete;
+
+  /**
+   * @brief Finds the embeddings of query in data among the candidates of cs
+   * and hands them to sink.
+   *
+   * @return MatchStats
+   */
+  MatchStats Run(const Graph& data, const Graph& query, const CandidateSet& cs,
+                 const MatchOptions& options, ResultSink& sink) {
+    return backtrack_.Run(data, query, cs, options, sink);
+  }
+
+  /**
+   * @brief Returns the profile of the last Run(), empty unless built with
+   * SEARCH_PROFILE.
+   *
+   * @return const SearchProfile&
+   */
+  const SearchProfile& GetProfile() const { return backtrack_.GetProfile(); }
+
+ private:
+  Backtrack backtrack_;
+};
+
+#endif  // MATCHER_H_
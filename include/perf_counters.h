@@ -0,0 +1,38 @@
+/**
+ * @file perf_counters.h
+ *
+ */
+
+#ifndef PERF_COUNTERS_H_
+#define PERF_COUNTERS_H_
+
+#include "common.h"
+
+/**
+ * @brief Hardware and software event counters of perf_event_open(2): cycles,
+ * instructions, cache references and misses, branch misses, task clock and
+ * page faults. They count the calling thread and the threads it starts
+ * after the construction, summed once those are joined. An event the kernel
+ * or the machine does not support (no PMU in a VM, perf_event_paranoid) is
+ * left out and reads -1; elsewhere than on Linux every event does.
+ */
+class PerfCounters {
+ public:
+  PerfCounters();
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  void Start();
+  void Stop();
+
+  size_t GetNumEvents() const;
+  const char* GetEventName(size_t i) const;
+  int64_t GetValue(size_t i) const;
+
+ private:
+  std::vector<int> fds_;  // per event, -1 if it could not be opened
+};
+
+#endif  // PERF_COUNTERS_H_
@@ -0,0 +1,105 @@
+/**
+ * @file plan_cache.h
+ *
+ */
+
+#ifndef PLAN_CACHE_H_
+#define PLAN_CACHE_H_
+
+#include "candidate_set.h"
+#include "candidate_space.h"
+#include "common.h"
+#include "dag.h"
+#include "graph.h"
+#include "match_options.h"
+#include "symmetry.h"
+
+#include <list>
+#include <unordered_map>
+
+/**
+ * @brief What the search plans for a query before it starts: the root and
+ * the DAG from it, the symmetry breaking, and the candidate space of the
+ * candidate set the plan was last used with.
+ */
+struct QueryPlan {
+  Vertex root = -1;  // -1 until the plan is made
+  DAG dag;
+  SymmetryBreaker symmetry;
+  // valid for the candidate set of this fingerprint only
+  bool has_space = false;
+  uint64_t candidate_fingerprint = 0;
+  CandidateSpace space;
+
+  // set by PlanCache: the key, and the query it was made for, to tell apart
+  // queries with the same hash
+  uint64_t key = 0;
+  std::vector<int32_t> signature;
+};
+
+/**
+ * @brief Hits, misses and evictions of a PlanCache since it was created.
+ */
+struct PlanCacheStats {
+  size_t hits = 0;         // the plan was in memory or on disk
+  size_t misses = 0;       // the query had to be planned
+  size_t disk_loads = 0;   // of the hits, read from the directory
+  size_t space_hits = 0;   // the candidate space was reused too
+  size_t evictions = 0;    // least recently used plans dropped
+  size_t size = 0;         // plans in memory
+};
+
+/**
+ * @brief Plans of the queries seen before, so that a query asked again
+ * against the same data graph skips straight to the search. A plan is keyed
+ * by the fingerprint of the data graph, the query's labels and edges in a
+ * canonical form (independent of the order of the edges in its file, not of
+ * its vertex ids) and the MatchOptions that change the plan. The candidate
+ * space is reused as long as the candidate set is the same, and rebuilt
+ * otherwise.
+ *
+ * At most capacity plans are kept in memory, the least recently used ones
+ * are dropped first. With a directory, every new plan is also written there,
+ * but for its candidate space, and plans missing in memory are looked for
+ * there, so that they outlive the process. A cache serves one search at a
+ * time.
+ */
+class PlanCache {
+ public:
+  static constexpr size_t kDefaultCapacity = 256;
+
+  explicit PlanCache(size_t capacity = kDefaultCapacity,
+                     const std::string& directory = "");
+
+  PlanCache(const PlanCache&) = delete;
+  PlanCache& operator=(const PlanCache&) = delete;
+
+  QueryPlan& Find(const Graph& data, const Graph& query,
+                  const MatchOptions& options);
+  void Store(const QueryPlan& plan);
+  const CandidateSpace& GetSpace(QueryPlan& plan, const Graph& data,
+                                 const Graph& query, const CandidateSet& cs);
+
+  void Clear();
+  inline const PlanCacheStats& GetStats() const;
+
+ private:
+  std::string GetFileName(uint64_t key) const;
+  bool Load(const Graph& query, QueryPlan& plan);
+
+  size_t capacity_;
+  std::string directory_;
+  // most recently used first
+  std::list<QueryPlan> plans_;
+  std::unordered_map<uint64_t, std::list<QueryPlan>::iterator> index_;
+  PlanCacheStats stats_;
+};
+
+/**
+ * @brief Returns the hits and misses so far.
+ *
+ * @return const PlanCacheStats&
+ */
+inline const PlanCacheStats& PlanCache::GetStats() const { return stats_; }
+
+#endif  // PLAN_CACHE_H_
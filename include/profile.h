@@ -0,0 +1,23 @@
+/**
+ * @file profile.h
+ *
+ */
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include "common.h"
+
+// Counting is compiled in only with -DSEARCH_PROFILE (cmake
+// -DSEARCH_PROFILE=ON); otherwise PROFILE() drops its statement and the
+// search runs as before. What is counted is reported by SearchProfile, see
+// search_profile.h.
+#ifdef SEARCH_PROFILE
+#define PROFILE(statement) statement
+// calls of Graph::IsNeighbor on this thread
+extern thread_local uint64_t num_is_neighbor_calls;
+#else
+#define PROFILE(statement)
+#endif
+
+#endif  // PROFILE_H_
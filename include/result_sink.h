@@ -0,0 +1,155 @@
+/**
+ * @file result_sink.h
+ *
+ */
+
+#ifndef RESULT_SINK_H_
+#define RESULT_SINK_H_
+
+#include "common.h"
+
+#include <functional>
+
+/**
+ * @brief Receives the matches of a query. Workers buffer embeddings and hand
+ * them over in batches, one batch at a time, so a sink does not need to be
+ * thread safe. An embedding lists the data vertex of every query vertex in
+ * query vertex id order.
+ */
+class ResultSink {
+ public:
+  virtual ~ResultSink() = default;
+
+  /**
+   * @brief Called once before the search.
+   *
+   * @param num_query_vertices the number of vertices in an embedding.
+   */
+  virtual void Begin(size_t num_query_vertices) {}
+  /**
+   * @brief Called once before the search instead of Begin() when the search
+   * goes on from a checkpoint, so that what Begin() writes is written once
+   * for the whole search, by the process that began it.
+   *
+   * @param num_query_vertices the number of vertices in an embedding.
+   */
+  virtual void Continue(size_t num_query_vertices) {
+    Begin(num_query_vertices);
+  }
+  /**
+   * @brief Called with num_rows embeddings stored back to back.
+   *
+   * @param rows
+   * @param num_rows
+   */
+  virtual void Consume(const Vertex* rows, size_t num_rows) {}
+  /**
+   * @brief Called once after the search.
+   *
+   * @param num_matches the number of matches found, at most the limit.
+   */
+  virtual void End(size_t num_matches) {}
+  /**
+   * @brief Writes out what the sink holds back, so that the output is
+   * complete up to the matches counted so far; called when the search is
+   * checkpointed.
+   */
+  virtual void Flush() {}
+  /**
+   * @brief Returns false if the sink only needs the number of matches, in
+   * which case the embeddings are not copied out of the search at all.
+   *
+   * @return bool
+   */
+  virtual bool NeedsEmbeddings() const { return true; }
+};
+
+/**
+ * @brief Writes "t N" followed by an "a ..." line per match, through a large
+ * buffer and write(2).
+ */
+class TextSink : public ResultSink {
+ public:
+  explicit TextSink(int fd);
+  ~TextSink() override;
+
+  void Begin(size_t num_query_vertices) override;
+  void Continue(size_t num_query_vertices) override {
+    row_size_ = num_query_vertices;
+  }
+  void Consume(const Vertex* rows, size_t num_rows) override;
+  void End(size_t num_matches) override;
+  void Flush() override;
+
+ private:
+
+  int fd_;
+  size_t row_size_ = 0;
+  std::vector<char> buffer_;
+  size_t size_ = 0;
+};
+
+/**
+ * @brief Writes every query as an int32 row width N, then N int32 data
+ * vertices per match, then an int32 -1, all in native byte order.
+ */
+class BinarySink : public ResultSink {
+ public:
+  explicit BinarySink(int fd);
+  ~BinarySink() override;
+
+  void Begin(size_t num_query_vertices) override;
+  void Continue(size_t num_query_vertices) override {
+    row_size_ = num_query_vertices;
+  }
+  void Consume(const Vertex* rows, size_t num_rows) override;
+  void End(size_t num_matches) override;
+  void Flush() override;
+
+ private:
+  void Append(const void* data, size_t size);
+
+  int fd_;
+  size_t row_size_ = 0;
+  std::vector<char> buffer_;
+  size_t size_ = 0;
+};
+
+/**
+ * @brief Only counts the matches.
+ */
+class CountSink : public ResultSink {
+ public:
+  void End(size_t num_matches) override { num_matches_ = num_matches; }
+  bool NeedsEmbeddings() const override { return false; }
+
+  size_t GetNumMatches() const { return num_matches_; }
+
+ private:
+  size_t num_matches_ = 0;
+};
+
+/**
+ * @brief Calls a function with every embedding and the number of query
+ * vertices. Calls never overlap, but may come from any worker thread.
+ */
+class CallbackSink : public ResultSink {
+ public:
+  using Callback = std::function<void(const Vertex*, size_t)>;
+
+  explicit CallbackSink(Callback callback) : callback_(std::move(callback)) {}
+
+  void Begin(size_t num_query_vertices) override {
+    row_size_ = num_query_vertices;
+  }
+  void Consume(const Vertex* rows, size_t num_rows) override {
+    for (size_t i = 0; i < num_rows; ++i)
+      callback_(rows + i * row_size_, row_size_);
+  }
+
+ private:
+  Callback callback_;
+  size_t row_size_ = 0;
+};
+
+#endif  // RESULT_SINK_H_
@@ -0,0 +1,102 @@
+/**
+ * @file search_profile.h
+ *
+ */
+
+#ifndef SEARCH_PROFILE_H_
+#define SEARCH_PROFILE_H_
+
+#include "common.h"
+#include "profile.h"
+
+#include <map>
+
+/**
+ * @brief Where a search spent its effort: nodes per depth and per query
+ * vertex, why candidates were rejected, how the candidate space served the
+ * extendable candidates, backtracks, a sample of the search tree and the
+ * hardware counters of the search. Filled only in SEARCH_PROFILE builds.
+ */
+class SearchProfile {
+ public:
+  // one path in this many nodes is sampled, per worker
+  static constexpr uint64_t kSamplePeriod = 64;
+  // distinct sampled paths kept, further ones are only counted as dropped
+  static constexpr size_t kMaxSampledPaths = 1 << 16;
+
+  static constexpr bool IsEnabled() {
+#ifdef SEARCH_PROFILE
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  void Clear(size_t num_query_vertices);
+  void Merge(const SearchProfile& other);
+  inline void AddNode(const Vertex* path, size_t depth);
+
+  void WriteReport(std::ostream& out) const;
+  void WriteJson(std::ostream& out) const;
+  void WriteFoldedStacks(std::ostream& out) const;
+
+  // of the query, filled once per search
+  std::vector<size_t> num_candidates;
+  std::vector<uint8_t> is_leaf;
+  Vertex root = -1;
+
+  // depth numCore and beyond are the leaves, matched after the core
+  std::vector<uint64_t> nodes_per_depth;
+  std::vector<uint64_t> nodes_per_vertex;
+  // a query vertex ran out of candidates, or the failing sets skipped its
+  // remaining ones
+  std::vector<uint64_t> backtracks;
+  std::vector<uint64_t> backjumps;
+
+  uint64_t rejected_visited = 0;  // candidate already mapped
+  uint64_t rejected_order = 0;    // against a symmetry-breaking constraint
+  uint64_t rejected_leaves = 0;   // too few free candidates for the leaves
+
+  // extendable candidates: straight from one candidate space list, or
+  // intersected over several parents, dropping the candidates that miss an
+  // edge to one of the parents' mappings
+  uint64_t extendable_copies = 0;
+  uint64_t extendable_intersections = 0;
+  uint64_t rejected_edges = 0;
+  uint64_t empty_extendable = 0;
+  uint64_t is_neighbor_calls = 0;
+
+  // root-to-node paths of query vertices, each seen count times in the
+  // samples
+  std::map<std::vector<Vertex>, uint64_t> samples;
+  uint64_t dropped_samples = 0;
+  uint64_t sample_countdown = kSamplePeriod;
+
+  // hardware and software event counts of the search phase, by name, -1
+  // where the event could not be counted
+  std::vector<std::pair<std::string, int64_t>> events;
+};
+
+/**
+ * @brief Counts a node at depth whose path from the root is path[0..depth],
+ * and samples the path every kSamplePeriod nodes.
+ *
+ * @param path query vertex mapped at each depth.
+ * @param depth
+ */
+inline void SearchProfile::AddNode(const Vertex* path, size_t depth) {
+  ++nodes_per_depth[depth];
+  ++nodes_per_vertex[path[depth]];
+  if (--sample_countdown != 0) return;
+  sample_countdown = kSamplePeriod;
+  std::vector<Vertex> key(path, path + depth + 1);
+  auto it = samples.find(key);
+  if (it != samples.end())
+    ++it->second;
+  else if (samples.size() < kMaxSampledPaths)
+    samples.emplace(std::move(key), 1);
+  else
+    ++dropped_samples;
+}
+
+#endif  // SEARCH_PROFILE_H_
@@ -0,0 +1,125 @@
+/**
+ * @file symmetry.h
+ *
+ */
+
+#ifndef SYMMETRY_H_
+#define SYMMETRY_H_
+
+#include "arena.h"
+#include "common.h"
+#include "graph.h"
+
+/**
+ * @brief Symmetry breaking for a query graph. Build() finds the automorphisms
+ * of the query that move its core vertices and turns them into ordering
+ * constraints v(u) < v(w) between core vertices, so that the search only
+ * finds one embedding per orbit of the automorphism group. The permutations
+ * give back the others: for an embedding M that satisfies the constraints,
+ * the embeddings u -> M(p[u]) over all permutations p are all distinct and
+ * together are every embedding of the orbit.
+ *
+ * Leaves are left out of the constraints; swapping the leaves of a vertex
+ * among themselves is up to whoever matches the leaves.
+ */
+class SymmetryBreaker {
+ public:
+  struct Constraint {
+    Vertex other;
+    bool less;  // v(u) < v(other) if true, v(u) > v(other) otherwise
+  };
+
+  SymmetryBreaker() = default;
+
+  void Build(const Graph& query, const std::vector<uint8_t>& is_leaf,
+             Arena* arena = nullptr);
+  void Clear(size_t num_query_vertices);
+
+  void Save(std::ostream& out) const;
+  bool Load(std::istream& in, size_t num_query_vertices);
+
+  inline size_t GetNumPermutations() const;
+  inline const Vertex* GetPermutation(size_t i) const;
+
+  inline bool HasConstraints(Vertex u) const;
+  inline size_t GetNumConstraints(Vertex u) const;
+  inline const Constraint& GetConstraint(Vertex u, size_t k) const;
+
+ private:
+  bool FindAutomorphism(Vertex from, Vertex to);
+  bool Extend(size_t i);
+  bool IsConsistent(Vertex x, Vertex y) const;
+
+  size_t num_vertices_ = 0;
+  // core vertices only; color_ tells apart those no automorphism can swap
+  std::vector<Vertex> core_;
+  std::vector<uint32_t> color_;
+  std::vector<uint8_t> adjacent_;  // core adjacency matrix, by query id
+  // leaves of core vertex u in leaf_[leaf_offset_[u], leaf_offset_[u + 1])
+  std::vector<size_t> leaf_offset_;
+  std::vector<Vertex> leaf_;
+  // partial automorphism of the search, by query id, -1 where unmapped
+  std::vector<Vertex> image_;
+  std::vector<uint8_t> used_;
+  std::vector<uint8_t> fixed_;
+  size_t budget_ = 0;
+
+  // num_vertices_ entries per permutation, the identity first
+  std::vector<Vertex> permutations_;
+  std::vector<Vertex> products_;  // the next permutations_, while built
+  // constraints of u in constraint_[constraint_offset_[u],
+  // constraint_offset_[u + 1])
+  std::vector<size_t> constraint_offset_;
+  std::vector<Constraint> constraint_;
+};
+
+/**
+ * @brief Returns the number of permutations, 1 if the query has no symmetry.
+ *
+ * @return size_t
+ */
+inline size_t SymmetryBreaker::GetNumPermutations() const {
+  return permutations_.size() / num_vertices_;
+}
+/**
+ * @brief Returns the i-th permutation of the query vertices. The first one
+ * is the identity.
+ *
+ * @param i
+ * @return const Vertex*
+ */
+inline const Vertex* SymmetryBreaker::GetPermutation(size_t i) const {
+  return permutations_.data() + i * num_vertices_;
+}
+
+/**
+ * @brief Returns true if u is ordered against another query vertex.
+ *
+ * @param u query vertex id.
+ * @return bool
+ */
+inline bool SymmetryBreaker::HasConstraints(Vertex u) const {
+  return constraint_offset_[u] != constraint_offset_[u + 1];
+}
+/**
+ * @brief Returns the number of ordering constraints of u.
+ *
+ * @param u query vertex id.
+ * @return size_t
+ */
+inline size_t SymmetryBreaker::GetNumConstraints(Vertex u) const {
+  return constraint_offset_[u + 1] - constraint_offset_[u];
+}
+/**
+ * @brief Returns the k-th ordering constraint of u.
+ *
+ * @param u query vertex id.
+ * @param k
+ * @return const SymmetryBreaker::Constraint&
+ */
+inline const SymmetryBreaker::Constraint& SymmetryBreaker::GetConstraint(
+    Vertex u, size_t k) const {
+  return constraint_[constraint_offset_[u] + k];
+}
+
+#endif  // SYMMETRY_H_
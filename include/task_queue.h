@@ -0,0 +1,75 @@
+/**
+ * @file task_queue.h
+ *
+ */
+
+#ifndef TASK_QUEUE_H_
+#define TASK_QUEUE_H_
+
+#include "common.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+/**
+ * @brief A subtree of the search tree: the query vertices matched above
+ * `depth` are fixed to `prefix`, and only the extendable candidates in
+ * [begin, end) are tried at `depth`.
+ */
+struct SearchTask {
+  size_t depth = 0;
+  std::vector<std::pair<Vertex, uint32_t>> prefix;  // (query vertex, position)
+  size_t begin = 0;
+  size_t end = 0;
+};
+
+/**
+ * @brief Per-worker task deques with work stealing. A worker pushes and pops
+ * at the back of its own deque, and steals from the front of the others,
+ * where the largest (shallowest) subtrees are.
+ */
+class TaskQueue {
+ public:
+  explicit TaskQueue(size_t num_workers);
+  ~TaskQueue();
+
+  void Push(size_t worker, SearchTask&& task);
+  bool Pop(size_t worker, SearchTask& task);
+  bool Steal(size_t worker, SearchTask& task);
+  void Finish();
+
+  inline bool IsEmpty(size_t worker) const;
+  inline size_t GetNumOutstanding() const;
+
+ private:
+  struct WorkerDeque {
+    std::mutex mutex;
+    std::deque<SearchTask> tasks;
+    std::atomic<size_t> size{0};
+  };
+
+  std::vector<WorkerDeque> deques_;
+  // queued + running tasks; the search is over when it drops to 0
+  std::atomic<size_t> num_outstanding_{0};
+};
+
+/**
+ * @brief Returns true if the deque of the worker has no queued task.
+ *
+ * @param worker worker id.
+ * @return bool
+ */
+inline bool TaskQueue::IsEmpty(size_t worker) const {
+  return deques_[worker].size.load(std::memory_order_relaxed) == 0;
+}
+/**
+ * @brief Returns the number of tasks queued or running.
+ *
+ * @return size_t
+ */
+inline size_t TaskQueue::GetNumOutstanding() const {
+  return num_outstanding_.load(std::memory_order_acquire);
+}
+
+#endif  // TASK_QUEUE_H_
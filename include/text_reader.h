@@ -0,0 +1,101 @@
+/**
+ * @file text_reader.h
+ *
+ */
+
+#ifndef TEXT_READER_H_
+#define TEXT_READER_H_
+
+#include "common.h"
+
+/**
+ * @brief Maps a whitespace-separated text file (.igraph, .cs) into memory and
+ * hands out its tokens. Integers are parsed by hand, without the locale-aware
+ * stream extraction of std::ifstream.
+ */
+class TextReader {
+ public:
+  explicit TextReader(const std::string& filename);
+  ~TextReader();
+
+  TextReader(const TextReader&) = delete;
+  TextReader& operator=(const TextReader&) = delete;
+
+  inline bool IsOpen() const;
+  inline size_t GetSize() const;
+
+  inline bool ReadChar(char& c);
+  template <typename T>
+  inline bool ReadInt(T& value);
+
+ private:
+  inline void SkipSpaces();
+
+  bool is_open_ = false;
+  void* mapped_ = nullptr;
+  size_t mapped_size_ = 0;
+
+  const char* cur_ = nullptr;
+  const char* end_ = nullptr;
+};
+
+/**
+ * @brief Returns true if the file could be opened.
+ *
+ * @return bool
+ */
+inline bool TextReader::IsOpen() const { return is_open_; }
+/**
+ * @brief Returns the size of the file in bytes.
+ *
+ * @return size_t
+ */
+inline size_t TextReader::GetSize() const { return mapped_size_; }
+
+inline void TextReader::SkipSpaces() {
+  while (cur_ != end_ && static_cast<unsigned char>(*cur_) <= ' ') ++cur_;
+}
+
+/**
+ * @brief Reads the next non-whitespace character, like `fin >> c`.
+ *
+ * @param c
+ * @return bool false at the end of the file.
+ */
+inline bool TextReader::ReadChar(char& c) {
+  SkipSpaces();
+  if (cur_ == end_) return false;
+  c = *cur_++;
+  return true;
+}
+
+/**
+ * @brief Reads the next (optionally negative) decimal integer, like
+ * `fin >> value`.
+ *
+ * @param value set to 0 on failure.
+ * @return bool false if there is no integer at the current position.
+ */
+template <typename T>
+inline bool TextReader::ReadInt(T& value) {
+  SkipSpaces();
+  bool negative = false;
+  if (cur_ != end_ && *cur_ == '-') {
+    negative = true;
+    ++cur_;
+  }
+  if (cur_ == end_ || *cur_ < '0' || *cur_ > '9') {
+    value = 0;
+    return false;
+  }
+
+  T result = 0;
+  while (cur_ != end_ && *cur_ >= '0' && *cur_ <= '9') {
+    result = result * 10 + (*cur_ - '0');
+    ++cur_;
+  }
+  value = negative ? static_cast<T>(0 - result) : result;
+  return true;
+}
+
+#endif  // TEXT_READER_H_
@@ -0,0 +1,29 @@
+/**
+ * @file convert_graph.cc
+ * @brief converts a text data graph into the binary CSR format
+ *
+ */
+
+#include "common.h"
+#include "graph.h"
+
+int main(int argc, char* argv[]) {
+  VertexOrder vertex_order = VertexOrder::kOriginal;
+  if (argc == 5 && std::string(argv[3]) == "--reorder") {
+    if (!ParseVertexOrder(argv[4], &vertex_order)) {
+      std::cerr << "Unknown vertex order " << argv[4] << "\n";
+      return EXIT_FAILURE;
+    }
+  } else if (argc != 3) {
+    std::cerr << "Usage: ./convert_graph <data graph file> <binary graph file> "
+                 "[--reorder none|degree|bfs]\n";
+    return EXIT_FAILURE;
+  }
+
+  // the binary file keeps the order, and the ids of the text file
+  Graph data(argv[1]);
+  data.Reorder(vertex_order);
+  data.Save(argv[2]);
+
+  return EXIT_SUCCESS;
+}
@@ -3,29 +3,443 @@
  *
  */
 
-#include "backtrack.h"
 #include "candidate_set.h"
+#include "checkpoint.h"
 #include "common.h"
+#include "continuous_matcher.h"
+#include "distributed_matcher.h"
 #include "graph.h"
+#include "matcher.h"
+#include "plan_cache.h"
+#include "result_sink.h"
+
+#include <chrono>
+#include <csignal>
+#include <memory>
+#include <sstream>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace {
+bool FileExists(const std::string& filename) {
+  return std::ifstream(filename).good();
+}
+
+// "text" (the default), "binary" or "count"
+std::unique_ptr<ResultSink> MakeSink(const std::string& format) {
+  if (format == "text")
+    return std::unique_ptr<ResultSink>(new TextSink(STDOUT_FILENO));
+  if (format == "binary")
+    return std::unique_ptr<ResultSink>(new BinarySink(STDOUT_FILENO));
+  if (format == "count") return std::unique_ptr<ResultSink>(new CountSink());
+  return nullptr;
+}
+
+void Report(const MatchStats& stats, const ResultSink& sink) {
+  // the count-only sink writes nothing itself
+  if (!sink.NeedsEmbeddings())
+    std::cout << "c " << stats.num_matches << std::endl;
+  if (stats.status == MatchStatus::kTimeout)
+    std::cerr << "Time budget exceeded after " << stats.num_matches
+              << " matches\n";
+}
+
+size_t Match(const Graph& data, const Graph& query, const CandidateSet& cs,
+             Matcher& matcher, const MatchOptions& options, ResultSink& sink) {
+  MatchStats stats = matcher.Run(data, query, cs, options, sink);
+  Report(stats, sink);
+  return stats.num_matches;
+}
+
+// raised by SIGTERM and by the checkpoint timer
+std::atomic<bool> suspend_requested(false);
+volatile sig_atomic_t terminate_requested = 0;
+
+void OnTerminate(int) {
+  terminate_requested = 1;
+  suspend_requested.store(true);
+}
+
+void OnCheckpointTimer(int) { suspend_requested.store(true); }
+
+// hands everything on but the Begin() and End() of the runs between
+// checkpoints, so that they write out as one search; resumed if that search
+// was begun by an earlier process, which wrote the Begin() already
+class ContinuedSink : public ResultSink {
+ public:
+  ContinuedSink(ResultSink& sink, bool resumed)
+      : sink_(sink), resumed_(resumed) {}
+
+  void Begin(size_t num_query_vertices) override {
+    if (begun_) return;
+    if (resumed_)
+      sink_.Continue(num_query_vertices);
+    else
+      sink_.Begin(num_query_vertices);
+    begun_ = true;
+  }
+  void Consume(const Vertex* rows, size_t num_rows) override {
+    sink_.Consume(rows, num_rows);
+  }
+  void Flush() override { sink_.Flush(); }
+  bool NeedsEmbeddings() const override { return sink_.NeedsEmbeddings(); }
+
+ private:
+  ResultSink& sink_;
+  bool resumed_;
+  bool begun_ = false;
+};
+
+/**
+ * @brief Matches like Match(), but on SIGTERM, and every interval_s seconds
+ * if positive, suspends the search and writes what it has left to the
+ * checkpoint file, from which --resume goes on. The search stops after
+ * SIGTERM and goes on after the timer. The file is removed once the search
+ * is over. The output of a stopped search is left without its end, and that
+ * of a resumed one without its beginning, so that the outputs appended are
+ * those of the search run at once.
+ *
+ * @return bool false if the search was stopped by SIGTERM.
+ */
+bool MatchWithCheckpoints(const Graph& data, const Graph& query,
+                          const CandidateSet& cs, Matcher& matcher,
+                          MatchOptions options, ResultSink& sink,
+                          const std::string& checkpoint_file_name,
+                          double interval_s) {
+  std::signal(SIGTERM, OnTerminate);
+  itimerval timer = {};
+  if (interval_s > 0) {
+    std::signal(SIGALRM, OnCheckpointTimer);
+    timer.it_interval.tv_sec = static_cast<time_t>(interval_s);
+    timer.it_interval.tv_usec = static_cast<suseconds_t>(
+        (interval_s - timer.it_interval.tv_sec) * 1e6);
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_REAL, &timer, nullptr);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  double time_budget_ms = options.time_budget_ms;
+  ContinuedSink continued(sink, options.resume != nullptr);
+  Checkpoint checkpoint, resumed;
+  options.suspend = &suspend_requested;
+  options.checkpoint = &checkpoint;
+  MatchStats stats;
+  while (true) {
+    if (time_budget_ms > 0) {
+      // the budget is for all the runs; a tiny one stops at once
+      double elapsed_ms = std::chrono::duration<double, std::milli>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+      options.time_budget_ms = std::max(time_budget_ms - elapsed_ms, 1e-3);
+    }
+    stats = matcher.Run(data, query, cs, options, continued);
+    if (stats.status != MatchStatus::kSuspended) break;
+    continued.Flush();
+    if (!checkpoint.Save(checkpoint_file_name))
+      std::cerr << "Checkpoint file " << checkpoint_file_name
+                << " could not be written\n";
+    // cleared first, so that a SIGTERM from now on suspends the next run
+    suspend_requested.store(false);
+    if (terminate_requested) break;
+    std::swap(resumed, checkpoint);
+    options.resume = &resumed;
+  }
+
+  timer = {};
+  setitimer(ITIMER_REAL, &timer, nullptr);
+  if (stats.status == MatchStatus::kSuspended) {
+    // the resumed process ends the output, so that the outputs of the two
+    // appended are those of the search run at once
+    sink.Flush();
+    std::cerr << "Suspended after " << stats.num_matches
+              << " matches, checkpoint in " << checkpoint_file_name << "\n";
+    return false;
+  }
+  sink.End(stats.num_matches);
+  Report(stats, sink);
+  std::remove(checkpoint_file_name.c_str());
+  return true;
+}
+
+/**
+ * @brief Answers every (query graph, candidate set) pair listed in the
+ * manifest, one pair per line, against the resident data graph. A line with no
+ * candidate set file is filtered in process. Matches go to stdout as in the
+ * single query mode, and a tab-separated line
+ * "<query> <candidate set> <matches> <milliseconds>" per query goes to stderr,
+ * then a line with the hits and misses of the plan cache, through which a
+ * query seen before skips planning.
+ */
+void RunBatch(const Graph& data, Matcher& matcher, const MatchOptions& options,
+              ResultSink& sink, std::istream& manifest, size_t refine_steps) {
+  std::string line;
+  while (std::getline(manifest, line)) {
+    std::istringstream fields(line);
+    std::string query_file_name, candidate_set_file_name;
+    if (!(fields >> query_file_name) || query_file_name[0] == '#') continue;
+    bool filter = !(fields >> candidate_set_file_name);
+    if (!FileExists(query_file_name) ||
+        (!filter && !FileExists(candidate_set_file_name))) {
+      std::cerr << "Query " << query_file_name << " or candidate set "
+                << candidate_set_file_name << " not found!\n";
+      continue;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    Graph query(query_file_name, data);
+    CandidateSet candidate_set =
+        filter ? CandidateSet(data, query, refine_steps)
+               : CandidateSet(candidate_set_file_name, data);
+    size_t matches = Match(data, query, candidate_set, matcher, options, sink);
+
+    auto end = std::chrono::steady_clock::now();
+    std::cerr << query_file_name << "\t"
+              << (filter ? "-" : candidate_set_file_name) << "\t"
+              << matches << "\t"
+              << std::chrono::duration<double, std::milli>(end - start).count()
+              << "\n";
+  }
+  const PlanCacheStats& stats = options.plan_cache->GetStats();
+  std::cerr << "plan cache\t" << stats.hits << " hits\t" << stats.misses
+            << " misses\t" << stats.space_hits << " candidate spaces reused\n";
+}
+
+/**
+ * @brief Applies every "+ v w" (insert) or "- v w" (delete) line of updates
+ * to the data graph, in the ids of its file, and prints the embeddings of
+ * the queries each one creates as "+ <query> v..." and destroys as
+ * "- <query> v...", the query numbered from 0 in the order of the command
+ * line. Updates that change nothing are skipped, and a line with the
+ * updates, the embeddings added and removed and the milliseconds goes to
+ * stderr last.
+ */
+void RunStream(const Graph& data, ContinuousMatcher& matcher,
+               std::istream& updates) {
+  std::string line, out;
+  size_t num_updates = 0, num_added = 0, num_removed = 0;
+  auto print = [&data, &out, &num_added, &num_removed](
+                   size_t query, bool inserted, const Vertex* embedding,
+                   size_t n) {
+    ++(inserted ? num_added : num_removed);
+    out = inserted ? "+ " : "- ";
+    out += std::to_string(query);
+    for (size_t u = 0; u < n; ++u) {
+      out += ' ';
+      out += std::to_string(data.GetOriginalId(embedding[u]));
+    }
+    std::cout << out << "\n";
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  while (std::getline(updates, line)) {
+    std::istringstream fields(line);
+    std::string op;
+    Vertex v, w;
+    if (!(fields >> op) || op[0] == '#') continue;
+    if ((op != "+" && op != "-") || !(fields >> v >> w) || v < 0 || w < 0 ||
+        static_cast<size_t>(v) >= data.GetNumVertices() ||
+        static_cast<size_t>(w) >= data.GetNumVertices()) {
+      std::cerr << "Bad update " << line << "\n";
+      continue;
+    }
+    v = data.GetInternalId(v);
+    w = data.GetInternalId(w);
+    UpdateStats stats = op == "+" ? matcher.InsertEdge(v, w, print)
+                                  : matcher.DeleteEdge(v, w, print);
+    num_updates += stats.applied;
+    if (stats.truncated)
+      std::cerr << "Update " << line << " stopped after " << stats.num_matches
+                << " matches\n";
+  }
+  std::cout << std::flush;
+  auto end = std::chrono::steady_clock::now();
+  std::cerr << "stream\t" << num_updates << " updates\t" << num_added
+            << " added\t" << num_removed << " removed\t"
+            << std::chrono::duration<double, std::milli>(end - start).count()
+            << " ms\n";
+}
+}  // namespace
 
 int main(int argc, char* argv[]) {
-  if (argc < 4) {
+  std::vector<std::string> file_names;
+  std::string manifest_file_name;
+  std::string updates_file_name;
+  size_t num_threads = 1;
+  size_t num_workers = 0;
+  size_t refine_steps = 5;
+  std::string output_format = "text";
+  std::string plan_directory;
+  std::string checkpoint_file_name;
+  double checkpoint_interval_s = 0;
+  std::string resume_file_name;
+  VertexOrder vertex_order = VertexOrder::kOriginal;
+  MatchOptions options;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--threads" && i + 1 < argc) {
+      num_threads = std::stoul(argv[++i]);
+    } else if (arg == "--workers" && i + 1 < argc) {
+      num_workers = std::stoul(argv[++i]);
+    } else if (arg == "--refine-steps" && i + 1 < argc) {
+      refine_steps = std::stoul(argv[++i]);
+    } else if (arg == "--limit" && i + 1 < argc) {
+      options.limit = std::stoul(argv[++i]);
+    } else if (arg == "--time-budget" && i + 1 < argc) {
+      options.time_budget_ms = std::stod(argv[++i]);
+    } else if (arg == "--failing-sets") {
+      options.failing_sets = true;
+    } else if (arg == "--reorder" && i + 1 < argc) {
+      if (!ParseVertexOrder(argv[++i], &vertex_order)) {
+        std::cerr << "Unknown vertex order " << argv[i] << "\n";
+        return EXIT_FAILURE;
+      }
+    } else if (arg == "--output" && i + 1 < argc) {
+      output_format = argv[++i];
+    } else if (arg == "--batch" && i + 1 < argc) {
+      manifest_file_name = argv[++i];
+    } else if (arg == "--stream" && i + 1 < argc) {
+      updates_file_name = argv[++i];
+    } else if (arg == "--plan-cache" && i + 1 < argc) {
+      plan_directory = argv[++i];
+    } else if (arg == "--checkpoint" && i + 1 < argc) {
+      checkpoint_file_name = argv[++i];
+    } else if (arg == "--checkpoint-interval" && i + 1 < argc) {
+      checkpoint_interval_s = std::stod(argv[++i]);
+    } else if (arg == "--resume" && i + 1 < argc) {
+      resume_file_name = argv[++i];
+    } else if (arg.size() > 2 && arg.compare(0, 2, "--") == 0) {
+      std::cerr << "Unknown option " << arg << "\n";
+      return EXIT_FAILURE;
+    } else {
+      file_names.push_back(arg);
+    }
+  }
+
+  bool batch = !manifest_file_name.empty();
+  bool stream = !updates_file_name.empty();
+  bool valid = batch    ? !stream && file_names.size() == 1
+               : stream ? file_names.size() >= 2
+                        : file_names.size() == 2 || file_names.size() == 3;
+  // worker processes serve the single query mode only
+  if (num_workers > 0 && (batch || stream)) valid = false;
+  // and so do checkpoints, of the search in this process
+  bool checkpoints = !checkpoint_file_name.empty() || !resume_file_name.empty();
+  if (checkpoints && (batch || stream || num_workers > 0)) valid = false;
+  if (checkpoint_interval_s > 0 && checkpoint_file_name.empty()) valid = false;
+  if (!valid) {
     std::cerr << "Usage: ./program <data graph file> <query graph file> "
-                 "<candidate set file>\n";
+                 "[<candidate set file>] [--threads N] [--refine-steps N] "
+                 "[--limit N] [--time-budget MS] [--failing-sets] "
+                 "[--reorder none|degree|bfs] [--output text|binary|count] "
+                 "[--plan-cache DIR] [--workers N] [--checkpoint FILE] "
+                 "[--checkpoint-interval SEC] [--resume FILE]\n"
+                 "       ./program <data graph file> --batch <manifest file "
+                 "| -> [--threads N] [--refine-steps N] [--limit N] "
+                 "[--time-budget MS] [--failing-sets] "
+                 "[--reorder none|degree|bfs] [--output text|binary|count] "
+                 "[--plan-cache DIR]\n"
+                 "       ./program <data graph file> <query graph file>... "
+                 "--stream <updates file | -> [--limit N] "
+                 "[--reorder none|degree|bfs]\n";
     return EXIT_FAILURE;
   }
 
-  std::string data_file_name = argv[1];
-  std::string query_file_name = argv[2];
-  std::string candidate_set_file_name = argv[3];
+  std::unique_ptr<ResultSink> sink = MakeSink(output_format);
+  if (!sink) {
+    std::cerr << "Unknown output format " << output_format << "\n";
+    return EXIT_FAILURE;
+  }
+
+  Graph data(file_names[0]);
+  data.Reorder(vertex_order);
+
+  if (stream) {
+    // --limit bounds the embeddings an update reports
+    ContinuousMatcher continuous(data, options.limit);
+    for (size_t i = 1; i < file_names.size(); ++i)
+      continuous.AddQuery(Graph(file_names[i], data));
+    if (updates_file_name == "-") {
+      RunStream(data, continuous, std::cin);
+    } else {
+      std::ifstream updates(updates_file_name);
+      if (!updates.is_open()) {
+        std::cerr << "Updates file " << updates_file_name << " not found!\n";
+        return EXIT_FAILURE;
+      }
+      RunStream(data, continuous, updates);
+    }
+    return EXIT_SUCCESS;
+  }
+
+  Matcher matcher(num_threads);
+  // in memory for the queries of a batch, and on disk across runs given a
+  // directory
+  PlanCache plan_cache(PlanCache::kDefaultCapacity, plan_directory);
+  if (batch || !plan_directory.empty()) options.plan_cache = &plan_cache;
 
-  Graph data(data_file_name);
-  Graph query(query_file_name, true);
-  CandidateSet candidate_set(candidate_set_file_name);
+  if (batch) {
+    if (manifest_file_name == "-") {
+      RunBatch(data, matcher, options, *sink, std::cin, refine_steps);
+    } else {
+      std::ifstream manifest(manifest_file_name);
+      if (!manifest.is_open()) {
+        std::cerr << "Manifest file " << manifest_file_name << " not found!\n";
+        return EXIT_FAILURE;
+      }
+      RunBatch(data, matcher, options, *sink, manifest, refine_steps);
+    }
+    return EXIT_SUCCESS;
+  }
 
-  Backtrack backtrack;
+  Graph query(file_names[1], data);
+  // without a candidate set file, candidates are filtered in process
+  CandidateSet candidate_set =
+      file_names.size() == 3 ? CandidateSet(file_names[2], data)
+                             : CandidateSet(data, query, refine_steps);
 
-  backtrack.PrintAllMatches(data, query, candidate_set);
+  if (num_workers > 0) {
+    // N processes, each with --threads search threads
+    DistributedMatcher distributed(num_workers, num_threads);
+    MatchStats stats =
+        distributed.Run(data, query, candidate_set, options, *sink);
+    Report(stats, *sink);
+    if (stats.status == MatchStatus::kFailed ||
+        distributed.GetNumLostSlices() > 0) {
+      std::cerr << "Workers failed, " << distributed.GetNumLostSlices()
+                << " slices lost, the search is incomplete\n";
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+
+  Checkpoint resumed;
+  if (!resume_file_name.empty()) {
+    if (!resumed.Load(resume_file_name)) {
+      std::cerr << "Checkpoint " << resume_file_name << " cannot be read!\n";
+      return EXIT_FAILURE;
+    }
+    if (!resumed.IsSearch(data, query, candidate_set, options)) {
+      std::cerr << "Checkpoint " << resume_file_name
+                << " was written for another search!\n";
+      return EXIT_FAILURE;
+    }
+    options.resume = &resumed;
+  }
+  if (!checkpoint_file_name.empty()) {
+    return MatchWithCheckpoints(data, query, candidate_set, matcher, options,
+                                *sink, checkpoint_file_name,
+                                checkpoint_interval_s)
+               ? EXIT_SUCCESS
+               : EXIT_FAILURE;
+  }
+  // a resumed search writes no header of its own
+  ContinuedSink continued(*sink, options.resume != nullptr);
+  MatchStats stats =
+      matcher.Run(data, query, candidate_set, options, continued);
+  sink->End(stats.num_matches);
+  Report(stats, *sink);
 
   return EXIT_SUCCESS;
 }
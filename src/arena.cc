@@ -0,0 +1,73 @@
+/**
+ * @file arena.cc
+ *
+ */
+
+#include "arena.h"
+
+#include <cstdlib>
+
+Arena::Arena(size_t block_size) : block_size_(block_size) {
+  blocks_.reserve(16);
+}
+
+Arena::~Arena() {
+  for (auto& block : blocks_) std::free(block.first);
+}
+
+/**
+ * @brief Returns uninitialized room for size bytes aligned to alignment, a
+ * power of two, valid until the next Reset().
+ *
+ * @param size
+ * @param alignment
+ * @return void*
+ */
+void* Arena::AllocateBytes(size_t size, size_t alignment) {
+  ++num_allocations_;
+  num_bytes_ += size;
+  uintptr_t address = reinterpret_cast<uintptr_t>(cursor_);
+  uintptr_t aligned = (address + alignment - 1) & ~(alignment - 1);
+  if (cursor_ == nullptr ||
+      aligned + size > reinterpret_cast<uintptr_t>(end_)) {
+    AddBlock(size + alignment);
+    address = reinterpret_cast<uintptr_t>(cursor_);
+    aligned = (address + alignment - 1) & ~(alignment - 1);
+  }
+  cursor_ = reinterpret_cast<char*>(aligned + size);
+  return reinterpret_cast<void*>(aligned);
+}
+
+/**
+ * @brief Frees everything allocated at once. The blocks are given back to
+ * the heap but for one, grown to hold as much as they did together.
+ *
+ */
+void Arena::Reset() {
+  size_t total = 0;
+  for (auto& block : blocks_) total += block.second;
+  if (blocks_.size() > 1) {
+    for (auto& block : blocks_) std::free(block.first);
+    blocks_.clear();
+    AddBlock(total);
+  }
+  if (!blocks_.empty()) {
+    cursor_ = blocks_.back().first;
+    end_ = cursor_ + blocks_.back().second;
+  }
+  num_allocations_ = 0;
+  num_bytes_ = 0;
+  num_heap_blocks_ = 0;
+}
+
+void Arena::AddBlock(size_t min_size) {
+  // blocks at least double, so that a growing vector costs few of them
+  size_t size = std::max(block_size_, min_size);
+  if (!blocks_.empty()) size = std::max(size, 2 * blocks_.back().second);
+  char* data = static_cast<char*>(std::malloc(size));
+  if (data == nullptr) throw std::bad_alloc();
+  blocks_.push_back(std::make_pair(data, size));
+  cursor_ = data;
+  end_ = data + size;
+  ++num_heap_blocks_;
+}
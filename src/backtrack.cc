@@ -5,324 +5,1008 @@
 
 #include "backtrack.h"
 
-#include <unordered_map>
+#include "intersection.h"
 
-//#define TRACE_DBG
+#include <thread>
+#include <unistd.h>
 
-Backtrack::Backtrack() {}
+// vertices buffered per worker before they are handed to the sink
+static const size_t kOutputBatchSize = 1 << 14;
+
+static inline size_t saturatingAdd(size_t a, size_t b) {
+  return a > SIZE_MAX - b ? SIZE_MAX : a + b;
+}
+
+static inline size_t saturatingMul(size_t a, size_t b) {
+  return b != 0 && a > SIZE_MAX / b ? SIZE_MAX : a * b;
+}
+
+Backtrack::Backtrack(size_t numThreads)
+  : numThreads(numThreads < 1 ? 1 : numThreads), states(this->numThreads) {}
 Backtrack::~Backtrack() {}
 
-int Backtrack::buildMatchingArray(const Graph& query, CandidateSet& cs,
-                       std::unordered_map<Vertex, Vertex>& vtxConvMap,
-                       std::unordered_map<Vertex, Vertex>& vtxRevConvMap,
-                       std::vector<int>& matchingArray, std::vector<int>& visitedMap) {
-  Vertex acc = 0; // order of candidate in whole candidates
-
-  for(size_t i = 0; i < query.GetNumVertices(); ++i) {
-    for(size_t j = 0; j < cs.GetCandidateSize(i); ++j) {
-      // loop for every candidates possible
-      Vertex v = cs.GetCandidate(i, j);
-      auto it = vtxConvMap.find(v);
-      if(it == vtxConvMap.end()) {
-        // if no vertex v in vtxConvMap
-        vtxConvMap.insert(std::make_pair(v, acc)); // insert v mapped with order
-        vtxRevConvMap.insert(std::make_pair(acc, v)); // insert order mapped with v
-        cs.SetCandidate(i, j, acc); // build new candidate set with order mapped
-        acc++;
-      } else {
-        // if vertex v already in vtxConvMap, which means that v is already visited by loop
-        cs.SetCandidate(i, j, it->second); // bulid new candidate set with order(same with v found before) mapped
+template <size_t W>
+Vertex Backtrack::getNext(SearchState& state) {
+  // among the unmapped vertices whose parents are all mapped, the one with the
+  // fewest extendable candidates under the current partial embedding
+  const size_t words = W ? W : numWords;
+  Vertex selected = -1;
+  size_t fewest = SIZE_MAX;
+  for(size_t w = 0; w < words; ++w) {
+    for(uint64_t bits = state.ready[w]; bits != 0; bits &= bits - 1) {
+      Vertex u = w * 64 + __builtin_ctzll(bits);
+      if(state.extendableSize[u] < fewest) {
+        fewest = state.extendableSize[u];
+        selected = u;
       }
     }
   }
+  return selected;
+}
 
-  matchingArray.resize(acc * acc); // used array for O(1) search time // todo : replace with vector?
-  for(int i = 0; i < acc * acc; ++i)
-    matchingArray[i] = -1; // initialize with -1
-
-  visitedMap.resize(acc);
-  for(int i = 0; i < acc; ++i)
-    visitedMap[i] = 0; // initialize with 0 // todo : why not check visited in if(it == vtxConvMap.end()) and else?
-
-  return acc;
+void Backtrack::mapVertex(const CandidateSet &cs, const CandidateSpace& space,
+                          const DAG& dag, SearchState& state,
+                          Vertex id, size_t candiPos) {
+  Vertex candidate = cs.GetCandidate(id, candiPos);
+  state.result[id] = candidate;
+  state.position[id] = candiPos;
+  state.visited[candidate >> 6] |= uint64_t(1) << (candidate & 63);
+  state.ready[id >> 6] &= ~(uint64_t(1) << (id & 63));
+  ++state.nodes;
+  for(size_t k = 0; k < dag.GetNumChildren(id); ++k) {
+    Vertex child = dag.GetChild(id, k);
+    if(--state.unmappedParents[child] == 0) {
+      state.ready[child >> 6] |= uint64_t(1) << (child & 63);
+      state.extendableSize[child] = computeExtendable(cs, space, dag, state, child);
+    }
+  }
 }
 
-void Backtrack::build(const Graph& graph, std::vector<DAGNode>& dag, std::vector<Vertex>& remains, size_t pointer) {
-  while(pointer < remains.size()) {
+void Backtrack::unmapVertex(const DAG& dag, SearchState& state, Vertex id) {
+  Vertex candidate = state.result[id];
+  state.visited[candidate >> 6] &= ~(uint64_t(1) << (candidate & 63));
+  state.result[id] = -1;
+  // vertices are unmapped in the reverse order, so id's parents are mapped
+  state.ready[id >> 6] |= uint64_t(1) << (id & 63);
+  for(size_t k = 0; k < dag.GetNumChildren(id); ++k) {
+    Vertex child = dag.GetChild(id, k);
+    if(state.unmappedParents[child]++ == 0)
+      state.ready[child >> 6] &= ~(uint64_t(1) << (child & 63));
+  }
+}
 
-    Vertex id = remains[pointer];
-    size_t startN = graph.GetNeighborStartOffset(id);
-    size_t endN = graph.GetNeighborEndOffset(id);
+size_t Backtrack::computeExtendable(const CandidateSet &cs, const CandidateSpace& space,
+                           const DAG& dag, SearchState& state, Vertex id) {
+  const std::vector<size_t>& position = state.position;
+  std::vector<uint32_t>& extendable = state.extendable[id];
+  std::vector<uint32_t>& scratch = state.scratch;
+  size_t numParents = dag.GetNumParents(id);
+
+  if(numParents == 0) {
+    // root : every candidate is extendable
+    size_t candidateSize = cs.GetCandidateSize(id);
+    for(size_t i = 0; i < candidateSize; ++i)
+      extendable[i] = i;
+    return candidateSize;
+  }
 
-    for(size_t i = startN; i < endN; ++i) {
-      Vertex v = graph.GetNeighbor(i); // v is neighbor of i
-      if(dag[v].IsEmpty()) {
-        // i is a parent of v
-        dag[id].SetDescendant(v);
-        // mark vertex visited by build()
-        bool check = true;
-        for(auto e : remains) {
-          if(e == v) {
-            check = false;
-            break;
-          }
-        }
-        if(check) 
-          remains.push_back(v);
-      }
-      else {
-        // v is a parent of i
-        dag[id].SetParent(v);
-      }
+  // start from the shortest list of candidates adjacent to a parent's mapping
+  size_t first = 0;
+  size_t size = SIZE_MAX;
+  for(size_t k = 0; k < numParents; ++k) {
+    size_t parentPos = position[dag.GetParent(id, k)];
+    size_t listSize = space.GetNeighborEnd(id, k, parentPos) -
+                      space.GetNeighborBegin(id, k, parentPos);
+    if(listSize < size) {
+      first = k;
+      size = listSize;
     }
-    ++pointer;
   }
+  const uint32_t* src = space.GetNeighborBegin(id, first, position[dag.GetParent(id, first)]);
+
+  if(numParents == 1) {
+    std::copy(src, src + size, extendable.begin());
+    PROFILE(++state.profile.extendable_copies);
+    PROFILE(state.profile.empty_extendable += size == 0);
+    return size;
+  }
+  PROFILE(size_t shortest = size);
+
+  // and intersect with the other parents' lists, all sorted by position,
+  // alternating between the two buffers so that the last result lands in
+  // extendable
+  size_t remaining = numParents - 1;
+  for(size_t k = 0; k < numParents && size > 0; ++k) {
+    if(k == first) continue;
+    size_t parentPos = position[dag.GetParent(id, k)];
+    const uint32_t* begin = space.GetNeighborBegin(id, k, parentPos);
+    const uint32_t* end = space.GetNeighborEnd(id, k, parentPos);
+    uint32_t* dst = --remaining % 2 == 0 ? extendable.data() : scratch.data();
+    size = Intersect(src, size, begin, end - begin, dst);
+    src = dst;
+  }
+  PROFILE(++state.profile.extendable_intersections);
+  PROFILE(state.profile.rejected_edges += shortest - size);
+  PROFILE(state.profile.empty_extendable += size == 0);
+  return size;
 }
 
-size_t pathCost = 0; // todo : delete before submit
+void Backtrack::flushOutput(SearchState& state) {
+  if(state.batch.empty()) return;
+  // the sink gets the ids of the data graph file
+  if(originalIds != nullptr) {
+    const Vertex* ids = originalIds;
+    for(Vertex& v : state.batch)
+      v = ids[v];
+  }
+  std::lock_guard<std::mutex> lock(outputMutex);
+  sink->Consume(state.batch.data(), state.batch.size() / state.result.size());
+  state.batch.clear();
+}
 
-Vertex Backtrack::getNext(std::vector<Vertex>& result, std::vector<DAGNode>& dag, std::vector<Vertex>& order) {
-  std::vector<Vertex> extendable;
+void Backtrack::stopSearch(MatchStatus status) {
+  // the first reason to stop wins
+  int expected = static_cast<int>(MatchStatus::kExhausted);
+  stopStatus.compare_exchange_strong(expected, static_cast<int>(status));
+  stop = true;
+}
 
-  for(size_t i = 0; i < result.size(); i++) {
-    auto v = result[i];
-    if(v < 0) {
-      bool parentVisited = true;
-      for(Vertex p : dag[i].GetParent()) {
-        if(result[p] < 0) { 
-          // one of parent node is not visited yet
-          parentVisited = false;
-          break;
-        }
-      }
-      if(parentVisited) {
-        // all parent nodes are visited already
-        extendable.push_back(i);
-      }
-    }
+void Backtrack::suspendTask(SearchState& state, size_t taskDepth, size_t depth) {
+  // a core mapped but not reported yet is mapped again on resume
+  if(depth == numCore)
+    --state.progress[--depth];
+  // what is left at every depth of the task, as the tasks trySplit makes
+  std::lock_guard<std::mutex> lock(pendingMutex);
+  for(size_t d = taskDepth; d <= depth; ++d) {
+    if(state.progress[d] >= state.limit[d]) continue;
+    SearchTask task;
+    task.depth = d;
+    for(size_t k = 0; k < d; ++k)
+      task.prefix.push_back(std::make_pair(state.order[k], static_cast<uint32_t>(state.position[state.order[k]])));
+    task.begin = state.progress[d];
+    task.end = state.limit[d];
+    pending.push_back(std::move(task));
   }
+}
 
-  size_t theMostMin = 0;
-  Vertex selected = -1;
+bool Backtrack::shouldAbort() {
+  if(cancel != nullptr && cancel->load(std::memory_order_relaxed)) {
+    stopSearch(MatchStatus::kCancelled);
+    return true;
+  }
+  if(hasDeadline && std::chrono::steady_clock::now() >= deadline) {
+    stopSearch(MatchStatus::kTimeout);
+    return true;
+  }
+  return false;
+}
 
-  for(auto e : extendable) {
-    size_t minStep = SIZE_MAX;
-
-    for(auto inEdge : dag[e].GetParent()) {
-      // inEdge is parent of vertex e, which is one of extendable vertices
-      for(size_t idx = 0; idx < order.size(); idx++) {
-        if(order[idx] == inEdge) {
-          // loop in order, and find if parent of vertex e is one of query
-          if(idx < minStep) { // modify minStep(maximum number of loop)
-            minStep = idx;
-          }
-          break;
-        }
-      }
+void Backtrack::computeAncestors(const DAG& dag) {
+  size_t numQueryVertices = dag.GetNumVertices();
+  ancestors.assign(numQueryVertices * numWords, 0);
+  // parents come first in the BFS order
+  for(Vertex u : dag.GetOrder()) {
+    uint64_t* anc = &ancestors[u * numWords];
+    anc[u >> 6] |= uint64_t(1) << (u & 63);
+    for(size_t k = 0; k < dag.GetNumParents(u); ++k) {
+      const uint64_t* parentAnc = &ancestors[dag.GetParent(u, k) * numWords];
+      for(size_t w = 0; w < numWords; ++w)
+        anc[w] |= parentAnc[w];
     }
+  }
+}
 
-    if(selected < 0) {
-      // if this is a first of loop
-      selected = e; // vertex that last loop looked at
-      theMostMin = minStep;
-    } else if(minStep > theMostMin) {
-      selected = e;
-      theMostMin = minStep; // for pathCost calculation // todo : delete before submit
+template <size_t W>
+void Backtrack::resetFailing(SearchState& state, size_t depth) {
+  const size_t words = W ? W : numWords;
+  std::fill_n(&state.failing[depth * words], words, 0);
+  state.succeeded[depth] = 0;
+}
+
+template <size_t W>
+void Backtrack::addConflict(SearchState& state, size_t depth, Vertex candidate) {
+  const size_t words = W ? W : numWords;
+  // the candidate is taken by a query vertex mapped above: the conflict
+  // involves both of them and whatever led to their candidates
+  Vertex owner = -1;
+  for(size_t d = 0; d < depth; ++d) {
+    if(state.result[state.order[d]] == candidate) {
+      owner = state.order[d];
+      break;
     }
   }
+  uint64_t* failing = &state.failing[depth * words];
+  const uint64_t* anc = &ancestors[state.order[depth] * words];
+  const uint64_t* ownerAnc = &ancestors[owner * words];
+  for(size_t w = 0; w < words; ++w)
+    failing[w] |= anc[w] | ownerAnc[w];
+}
 
-  pathCost += (order.size() - theMostMin);
+template <size_t W>
+void Backtrack::backjump(SearchState& state, size_t depth) {
+  const size_t words = W ? W : numWords;
+  // the node below depth is done; fold its failing set into this one
+  if(state.succeeded[depth + 1]) {
+    state.succeeded[depth] = 1;
+    return;
+  }
+  const uint64_t* child = &state.failing[(depth + 1) * words];
+  Vertex next = state.order[depth + 1];
+  if(state.extendableSize[next] == 0)
+    child = &ancestors[next * words];
+
+  uint64_t* failing = &state.failing[depth * words];
+  Vertex id = state.order[depth];
+  if((child[id >> 6] >> (id & 63)) & 1) {
+    for(size_t w = 0; w < words; ++w)
+      failing[w] |= child[w];
+  } else {
+    // the failure did not depend on id, so any other candidate of id would
+    // fail the same way
+    std::copy(child, child + words, failing);
+    PROFILE(state.profile.backjumps[id] += state.progress[depth] < state.limit[depth]);
+    state.progress[depth] = state.limit[depth];
+  }
+}
 
-  return selected;
+void Backtrack::findLeaves(const Graph &query) {
+  // a degree-one vertex hanging off a vertex of higher degree; both ends of
+  // a lone edge stay in the core
+  isLeaf.assign(query.GetNumVertices(), 0);
+  for(size_t u = 0; u < query.GetNumVertices(); ++u) {
+    if(query.GetDegree(u) != 1) continue;
+    Vertex parent = query.GetNeighbor(query.GetNeighborStartOffset(u));
+    if(query.GetDegree(parent) > 1)
+      isLeaf[u] = 1;
+  }
 }
 
-bool verification(const std::vector<Vertex>& result, const Graph& data, const Graph& query, const CandidateSet &cs) {
+void Backtrack::groupLeaves(const Graph &query, const CandidateSet &cs, const DAG& dag) {
+  size_t numQueryVertices = query.GetNumVertices();
+  leaves.clear();
+  leafBlocks.clear();
+  for(size_t u = 0; u < numQueryVertices; ++u) {
+    // a leaf the BFS started a component from has no parent to hang off
+    if(isLeaf[u] && dag.IsRoot(u))
+      isLeaf[u] = 0;
+    if(isLeaf[u])
+      leaves.push_back(u);
+  }
+  numCore = numQueryVertices - leaves.size();
+
+  std::sort(leaves.begin(), leaves.end(), [&](Vertex a, Vertex b) {
+    Label la = query.GetLabel(a), lb = query.GetLabel(b);
+    if(la != lb) return la < lb;
+    Vertex pa = dag.GetParent(a, 0), pb = dag.GetParent(b, 0);
+    return pa != pb ? pa < pb : a < b;
+  });
+  auto sameCandidates = [&](Vertex a, Vertex b) {
+    if(cs.GetCandidateSize(a) != cs.GetCandidateSize(b)) return false;
+    for(size_t i = 0; i < cs.GetCandidateSize(a); ++i)
+      if(cs.GetCandidate(a, i) != cs.GetCandidate(b, i)) return false;
+    return true;
+  };
+  for(size_t i = 0; i < leaves.size(); ++i) {
+    Vertex u = leaves[i];
+    if(!leafBlocks.empty()) {
+      LeafBlock& block = leafBlocks.back();
+      Vertex first = leaves[block.begin];
+      if(query.GetLabel(u) == query.GetLabel(first) &&
+         dag.GetParent(u, 0) == dag.GetParent(first, 0) && sameCandidates(u, first)) {
+        block.end = i + 1;
+        continue;
+      }
+      block.lastOfLabel = query.GetLabel(u) != query.GetLabel(first);
+    }
+    leafBlocks.push_back({i, i + 1, true});
+  }
+
+  leafBlockOffset.assign(numQueryVertices + 1, 0);
+  for(const LeafBlock& block : leafBlocks)
+    ++leafBlockOffset[dag.GetParent(leaves[block.begin], 0) + 1];
+  for(size_t u = 0; u < numQueryVertices; ++u)
+    leafBlockOffset[u + 1] += leafBlockOffset[u];
+  leafBlocksByParent.resize(leafBlocks.size());
+  ArenaVector<size_t> next(leafBlockOffset.begin(), leafBlockOffset.end() - 1,
+                           ArenaAllocator<size_t>(&arena));
+  for(size_t b = 0; b < leafBlocks.size(); ++b)
+    leafBlocksByParent[next[dag.GetParent(leaves[leafBlocks[b].begin], 0)]++] = b;
+}
 
-  //set test
-  std::set<Vertex> st;
-  for(auto e:result) {
-    st.insert(e);
+bool Backtrack::leavesFit(const CandidateSet &cs, const CandidateSpace& space,
+                          SearchState& state, Vertex id, size_t candiPos) {
+  // every block of leaves under id needs as many free candidates next to
+  // candiPos as it has leaves; the core search would not see otherwise that
+  // its subtree cannot match
+  for(size_t k = leafBlockOffset[id]; k < leafBlockOffset[id + 1]; ++k) {
+    const LeafBlock& block = leafBlocks[leafBlocksByParent[k]];
+    size_t needed = block.end - block.begin;
+    Vertex leaf = leaves[block.begin];
+    const uint32_t* it = space.GetNeighborBegin(leaf, 0, candiPos);
+    const uint32_t* end = space.GetNeighborEnd(leaf, 0, candiPos);
+    if(static_cast<size_t>(end - it) < needed) return false;
+    for(; it != end && needed > 0; ++it) {
+      Vertex candidate = cs.GetCandidate(leaf, *it);
+      needed -= !((state.visited[candidate >> 6] >> (candidate & 63)) & 1);
+    }
+    if(needed > 0) return false;
   }
-  if(st.size() != result.size()) {
-    std::cout << "There's duplicated vertex" << std::endl;
+  return true;
+}
+
+template <size_t W>
+bool Backtrack::isOrdered(SearchState& state, size_t depth, Vertex id, Vertex candidate) {
+  const size_t words = W ? W : numWords;
+  // symmetry breaking: candidate has to be on the right side of the mapped
+  // vertices id is ordered against
+  for(size_t k = 0; k < symmetry->GetNumConstraints(id); ++k) {
+    const SymmetryBreaker::Constraint& constraint = symmetry->GetConstraint(id, k);
+    Vertex other = state.result[constraint.other];
+    if(other < 0 || (constraint.less ? candidate < other : candidate > other)) continue;
+    if(failingSets) {
+      uint64_t* failing = &state.failing[depth * words];
+      const uint64_t* anc = &ancestors[id * words];
+      const uint64_t* otherAnc = &ancestors[constraint.other * words];
+      for(size_t w = 0; w < words; ++w)
+        failing[w] |= anc[w] | otherAnc[w];
+    }
     return false;
   }
-  for(size_t i = 0; i < query.GetNumVertices(); ++i) {
-    size_t size = cs.GetCandidateSize(i);
-    bool chk = false;
-    for(size_t j = 0; j < size; ++j) {
-      if(result[i] == cs.GetCandidate(i, j)) {
-        chk = true;
-        break;
-      }
+  return true;
+}
+
+size_t Backtrack::addMatches(size_t num) {
+  // matches only counted, never more than the limit
+  num = std::min(num, matchLimit);
+  size_t count = successCount.fetch_add(num) + num;
+  if(count == num)
+    firstMatch = std::chrono::steady_clock::now();
+  if(count >= matchLimit)
+    stopSearch(MatchStatus::kLimit);
+  return num;
+}
+
+size_t Backtrack::reportMatch(SearchState& state) {
+  // the embedding found stands for one per permutation of the query
+  size_t numPermutations = symmetry->GetNumPermutations();
+  if(!emitEmbeddings)
+    return addMatches(numPermutations);
+
+  size_t found = 0;
+  for(size_t i = 0; i < numPermutations; ++i) {
+    size_t count = ++successCount;
+    if(count > matchLimit) {
+      stopSearch(MatchStatus::kLimit);
+      break;
     }
-    if(!chk){
-      std::cout << "Wrong label vertex...." << i << std::endl;
-      return false;
+    if(count == 1)
+      firstMatch = std::chrono::steady_clock::now();
+    if(i == 0) {
+      state.batch.insert(state.batch.end(), state.result.begin(), state.result.end());
+    } else {
+      const Vertex* permutation = symmetry->GetPermutation(i);
+      for(size_t u = 0; u < state.result.size(); ++u)
+        state.batch.push_back(state.result[permutation[u]]);
+    }
+    if(state.batch.size() >= kOutputBatchSize)
+      flushOutput(state);
+    ++found;
+    if(count >= matchLimit) {
+      stopSearch(MatchStatus::kLimit);
+      break;
     }
   }
-  for(size_t i = 0; i < query.GetNumVertices(); ++i) {
-    size_t stOffset = query.GetNeighborStartOffset(i);
-    size_t endOffset = query.GetNeighborEndOffset(i);
-    for(size_t j = stOffset; j < endOffset; ++j) {
-      Vertex neighbor = query.GetNeighbor(j);
-      if(!data.IsNeighbor(result[i], result[neighbor])) {
-        std::cout << "Edge error...." << i << " " << neighbor << " "<< result[i] << " " << result[neighbor] << std::endl;
-        return false;
+  return found;
+}
+
+size_t Backtrack::enumerateLeaves(const CandidateSet &cs, const CandidateSpace& space,
+                                  const DAG& dag, SearchState& state, size_t i) {
+  if(i == leaves.size())
+    return reportMatch(state);
+
+  if(i == 0) {
+    // the leaves with the fewest free candidates first, where a dead end
+    // costs the least
+    for(size_t k = 0; k < leaves.size(); ++k) {
+      Vertex leaf = leaves[k];
+      size_t parentPos = state.position[dag.GetParent(leaf, 0)];
+      size_t available = 0;
+      const uint32_t* end = space.GetNeighborEnd(leaf, 0, parentPos);
+      for(const uint32_t* it = space.GetNeighborBegin(leaf, 0, parentPos); it != end; ++it) {
+        Vertex candidate = cs.GetCandidate(leaf, *it);
+        available += !((state.visited[candidate >> 6] >> (candidate & 63)) & 1);
       }
+      state.leafOrder[k] = std::make_pair(available, leaf);
     }
+    std::sort(state.leafOrder.begin(), state.leafOrder.end());
   }
-  // std::cout << "verification success" << std::endl;
-  return true;
+
+  // a leaf's candidates are those adjacent to its parent's mapping
+  Vertex id = state.leafOrder[i].second;
+  size_t parentPos = state.position[dag.GetParent(id, 0)];
+  const uint32_t* end = space.GetNeighborEnd(id, 0, parentPos);
+  size_t found = 0;
+  for(const uint32_t* it = space.GetNeighborBegin(id, 0, parentPos); it != end; ++it) {
+    if(stop.load(std::memory_order_relaxed)) break;
+    if(--state.pollCountdown == 0) {
+      state.pollCountdown = 1024;
+      if(shouldAbort()) break;
+    }
+    Vertex candidate = cs.GetCandidate(id, *it);
+    if((state.visited[candidate >> 6] >> (candidate & 63)) & 1) continue;
+
+    state.result[id] = candidate;
+    state.visited[candidate >> 6] |= uint64_t(1) << (candidate & 63);
+    ++state.nodes;
+    PROFILE(state.order[numCore + i] = id);
+    PROFILE(state.profile.AddNode(state.order.data(), numCore + i));
+    found += enumerateLeaves(cs, space, dag, state, i + 1);
+    state.visited[candidate >> 6] &= ~(uint64_t(1) << (candidate & 63));
+    state.result[id] = -1;
+  }
+  return found;
 }
 
-void Backtrack::buildOrder(std::vector<Vertex>& result, std::vector<DAGNode>& dag, std::vector<Vertex>& order, Vertex start = 0) {
-  pathCost = 0;
-  Vertex next = start;
-  while(1) {
-    if(next < 0) {
-      // if this vertex next is last vertex
-      break;
+size_t Backtrack::countLeaves(const CandidateSet &cs, const CandidateSpace& space,
+                              const DAG& dag, SearchState& state) {
+  // leaves of different labels never share a candidate, so the number of
+  // assignments is the product of those of every label
+  size_t total = 1;
+  for(size_t b = 0; b < leafBlocks.size() && total > 0; ) {
+    total = saturatingMul(total, countBlocks(cs, space, dag, state, b));
+    while(!leafBlocks[b++].lastOfLabel) {}
+  }
+  if(total == 0) return 0;
+  return addMatches(saturatingMul(total, symmetry->GetNumPermutations()));
+}
+
+size_t Backtrack::countBlocks(const CandidateSet &cs, const CandidateSpace& space,
+                              const DAG& dag, SearchState& state, size_t b) {
+  // the injective assignments of blocks b.. up to the end of their label
+  const LeafBlock& block = leafBlocks[b];
+  size_t size = block.end - block.begin;
+  Vertex id = leaves[block.begin];
+  size_t parentPos = state.position[dag.GetParent(id, 0)];
+  const uint32_t* begin = space.GetNeighborBegin(id, 0, parentPos);
+  const uint32_t* end = space.GetNeighborEnd(id, 0, parentPos);
+
+  if(block.lastOfLabel) {
+    // size interchangeable leaves over the free candidates
+    size_t available = 0;
+    for(const uint32_t* it = begin; it != end; ++it) {
+      Vertex candidate = cs.GetCandidate(id, *it);
+      available += !((state.visited[candidate >> 6] >> (candidate & 63)) & 1);
     }
-    order.push_back(next);
-    result[next] = 0;
-    next = getNext(result, dag, order);
+    if(available < size) return 0;
+    size_t count = 1;
+    for(size_t k = 0; k < size; ++k)
+      count = saturatingMul(count, available - k);
+    return count;
   }
-  order.push_back(-1);
-  #ifdef TRACE_DBG
-  std::cout << "Path Cost : " << pathCost << std::endl;
-  #endif
+
+  // the blocks after this one only depend on which candidates it takes, not
+  // on which of its leaves takes which
+  size_t count = countCombinations(cs, space, dag, state, b, begin, end, size);
+  for(size_t k = 2; k <= size; ++k)
+    count = saturatingMul(count, k);
+  return count;
 }
 
-void Backtrack::doCheck(const Graph &data, const CandidateSet &cs, std::vector<Vertex>& result,
-             std::vector<DAGNode>& dag, const std::vector<Vertex>& order,
-             std::vector<int> visitedMap, std::unordered_map<Vertex, Vertex> vtxRevConvMap,
-             std::vector<int> matchingArray, int acc) {
+size_t Backtrack::countCombinations(const CandidateSet &cs, const CandidateSpace& space,
+                                    const DAG& dag, SearchState& state, size_t b,
+                                    const uint32_t* it, const uint32_t* end,
+                                    size_t remaining) {
+  if(remaining == 0)
+    return countBlocks(cs, space, dag, state, b + 1);
+
+  Vertex id = leaves[leafBlocks[b].begin];
+  size_t count = 0;
+  for(; static_cast<size_t>(end - it) >= remaining; ++it) {
+    Vertex candidate = cs.GetCandidate(id, *it);
+    if((state.visited[candidate >> 6] >> (candidate & 63)) & 1) continue;
+
+    state.visited[candidate >> 6] |= uint64_t(1) << (candidate & 63);
+    ++state.nodes;
+    // counted leaves all go to depth numCore, in no particular order
+    PROFILE(state.order[numCore] = id);
+    PROFILE(state.profile.AddNode(state.order.data(), numCore));
+    count = saturatingAdd(count, countCombinations(cs, space, dag, state, b, it + 1,
+                                                   end, remaining - 1));
+    state.visited[candidate >> 6] &= ~(uint64_t(1) << (candidate & 63));
+  }
+  return count;
+}
 
-  size_t depth = 0; // search for n-th query vertex
+bool Backtrack::trySplit(SearchState& state, size_t taskDepth, size_t depth,
+                         TaskQueue& queue, size_t workerId) {
+  // give away the upper half of the shallowest range that still has work left
+  for(size_t d = taskDepth; d <= depth && d < numCore; ++d) {
+    size_t remaining = state.limit[d] - state.progress[d];
+    // at the current depth, keep at least one candidate for ourselves
+    if(remaining == 0 || (d == depth && remaining < 2)) continue;
+
+    SearchTask task;
+    task.depth = d;
+    for(size_t k = 0; k < d; ++k)
+      task.prefix.push_back(std::make_pair(state.order[k], static_cast<uint32_t>(state.position[state.order[k]])));
+    task.begin = state.progress[d] + remaining / 2;
+    task.end = state.limit[d];
+    state.limit[d] = task.begin;
+    // the failing set of this node is no longer known, as if it had a match
+    if(failingSets)
+      state.succeeded[d] = 1;
+    queue.Push(workerId, std::move(task));
+    return true;
+  }
+  return false;
+}
+
+template <size_t W>
+inline void Backtrack::openDepth(SearchState& state, size_t depth,
+                                 size_t begin, size_t end) {
+  Vertex id = getNext<W>(state);
+  state.order[depth] = id;
+  state.progress[depth] = begin;
+  state.limit[depth] = std::min(end, state.extendableSize[id]);
+  if(failingSets)
+    resetFailing<W>(state, depth);
+}
 
-  std::vector<size_t> progress;
-  progress.resize(order.size());
-  for(auto& e : progress) {
-    e = 0;
+template <size_t W>
+void Backtrack::doCheck(const Graph &data, const CandidateSet &cs,
+             const DAG& dag, const CandidateSpace& space,
+             SearchState& state, const SearchTask& task, TaskQueue& queue,
+             size_t workerId) {
+  std::vector<Vertex>& order = state.order;
+
+  // the query vertices above the task depth are fixed by the task
+  for(size_t d = 0; d < task.prefix.size(); ++d) {
+    order[d] = task.prefix[d].first;
+    mapVertex(cs, space, dag, state, task.prefix[d].first, task.prefix[d].second);
   }
-  while(true) {
-    Vertex id = order[depth];
-    if(id < 0) {
-      // sucessfully arrived at last vertex
-      std::cout << "\n" << "a ";
-      for(int ord = 0; ord < depth; ord++) {
-        auto idx = order[ord];
-        std::cout << vtxRevConvMap.at(result[idx]) << " ";
+
+  size_t depth = task.depth; // search for n-th query vertex
+  openDepth<W>(state, depth, task.begin, task.end);
+  searchLoop<W>(cs, dag, space, state, task.depth, depth, &queue, workerId, false);
+  if(!stop.load() && isSuspended())
+    suspendTask(state, task.depth, depth);
+
+  // release whatever is still mapped when the search was stopped
+  while(depth > 0)
+    unmapVertex(dag, state, order[--depth]);
+}
+
+template <size_t W>
+bool Backtrack::searchLoop(const CandidateSet &cs, const DAG& dag,
+             const CandidateSpace& space, SearchState& state, size_t taskDepth,
+             size_t& depthRef, TaskQueue* queue, size_t workerId,
+             bool yieldMatches) {
+  const size_t words = W ? W : numWords;
+  std::vector<Vertex>& order = state.order;
+  std::vector<size_t>& progress = state.progress;
+  std::vector<size_t>& limit = state.limit;
+  size_t depth = depthRef;
+
+  while(!stop.load(std::memory_order_relaxed)) {
+    // the clock and the cancellation flag are only looked at now and then
+    if(--state.pollCountdown == 0) {
+      state.pollCountdown = 1024;
+      if(shouldAbort() || isSuspended()) break;
+    }
+
+    if(numThreads > 1 && idleWorkers.load(std::memory_order_relaxed) > 0 && queue->IsEmpty(workerId))
+      trySplit(state, taskDepth, depth, *queue, workerId);
+
+    if(depth == numCore) {
+      // a pulled search hands the match out, and goes on from here when
+      // asked for the next one
+      if(yieldMatches) {
+        depthRef = depth;
+        return true;
       }
-      // get out from loop, once
-      id = order[--depth];
-      visitedMap[result[id]] = 0;
-      result[id] = -1;
-      successCount++;
-      if(successCount >= 100000)
-        return;
+      // the core is mapped, the leaves only need free candidates next to
+      // their parents
+      if(leaves.empty())
+        reportMatch(state);
+      else if(emitEmbeddings)
+        enumerateLeaves(cs, space, dag, state, 0);
+      else
+        countLeaves(cs, space, dag, state);
+      // get out from loop, once. Why the leaves failed is not tracked, so
+      // the failing set is unknown either way
+      unmapVertex(dag, state, order[--depth]);
+      if(failingSets)
+        state.succeeded[depth] = 1;
+      if(stop.load(std::memory_order_relaxed)) break;
     }
-    
-    int candidateSize = cs.GetCandidateSize(id);
+
+    Vertex id = order[depth];
     bool goNext = false; // check invalid subgraph
 
-    for(; progress[depth] < candidateSize; ++progress[depth]) {
-      // for all candidates in id
-      Vertex candiIdx = cs.GetCandidate(id, progress[depth]);
-      bool isValidSubgraph = true;
+    for(; progress[depth] < limit[depth]; ++progress[depth]) {
+      // for all extendable candidates in id
+      uint32_t candiPos = state.extendable[id][progress[depth]];
+      Vertex candidate = cs.GetCandidate(id, candiPos);
 
-      if(visitedMap[candiIdx]) {
+      if((state.visited[candidate >> 6] >> (candidate & 63)) & 1) {
         // if this candidate have been already visited, look at next candidate
+        if(failingSets)
+          addConflict<W>(state, depth, candidate);
+        PROFILE(++state.profile.rejected_visited);
         continue;
-      } else {
-        for(auto parent : dag[id].GetParent()) {
-          Vertex idxB = result[parent];
-          int checkIdx = 0;
-
-          if(candiIdx > idxB ) {
-            checkIdx = idxB * acc + candiIdx;
-          }
-          else {
-            checkIdx = candiIdx * acc + idxB;
-          }
-
-          int& chk = matchingArray[candiIdx * acc + idxB];
-          if(chk == -1) {
-            Vertex convIdxA = vtxRevConvMap[candiIdx];
-            Vertex convIdxB = vtxRevConvMap[idxB];
-            if(data.IsNeighbor(convIdxA, convIdxB)) {
-              chk = 1;
-            }
-            else {
-              chk = 0;
-            }
-          }     
-          if(!chk) {
-            isValidSubgraph = false;
-            break;
-          }
-        }
       }
-
-      if(isValidSubgraph) {
-        result[id] = candiIdx;
-        visitedMap[candiIdx] = 1;
-        progress[depth]++;
-        progress[++depth] = 0;
-        goNext = true;
-        break;
+      if(symmetry->HasConstraints(id) && !isOrdered<W>(state, depth, id, candidate)) {
+        PROFILE(++state.profile.rejected_order);
+        continue;
       }
+      if(leafBlockOffset[id] != leafBlockOffset[id + 1] &&
+         !leavesFit(cs, space, state, id, candiPos)) {
+        // which mappings took the leaves' candidates is not tracked, so
+        // the failure may involve any of them
+        if(failingSets)
+          std::fill_n(&state.failing[depth * words], words, ~uint64_t(0));
+        PROFILE(++state.profile.rejected_leaves);
+        continue;
+      }
+
+      mapVertex(cs, space, dag, state, id, candiPos);
+      PROFILE(state.profile.AddNode(order.data(), depth));
+      progress[depth]++;
+      if(++depth < numCore)
+        openDepth<W>(state, depth, 0, SIZE_MAX);
+      goNext = true;
+      break;
     }
 
     if(!goNext) {
-      if(depth <= 0) break;
-      id = order[--depth];
-      visitedMap[result[id]] = 0;
-      result[id] = -1;
+      PROFILE(++state.profile.backtracks[id]);
+      if(depth <= taskDepth) break;
+      unmapVertex(dag, state, order[--depth]);
+      if(failingSets)
+        backjump<W>(state, depth);
     }
   }
+
+  depthRef = depth;
+  return false;
 }
 
-void Backtrack::PrintAllMatches(const Graph &data, const Graph &query, CandidateSet &cs) {
-  
-  std::cout << "t " << query.GetNumVertices();
-  
-  std::vector<DAGNode> dag; // vector containing dagnodes
-  dag.resize(query.GetNumVertices());
+void Backtrack::initState(const Graph &data, const CandidateSet &cs,
+                 const DAG& dag, const CandidateSpace& space,
+                 SearchState& state) {
+  size_t numQueryVertices = dag.GetNumVertices();
+  // buffers of the previous query are reused, only resized
+  state.result.assign(numQueryVertices, -1);
+  state.position.assign(numQueryVertices, 0);
+  // every search leaves visited all zero
+  if(state.visited.size() != (data.GetNumVertices() + 63) / 64)
+    state.visited.assign((data.GetNumVertices() + 63) / 64, 0);
+  state.unmappedParents.resize(numQueryVertices);
+  state.ready.assign(numWords, 0);
+  state.extendable.resize(numQueryVertices);
+  state.extendableSize.assign(numQueryVertices, 0);
+  state.order.assign(numQueryVertices, -1);
+  state.progress.assign(numQueryVertices, 0);
+  state.limit.assign(numQueryVertices, 0);
+  state.leafOrder.resize(leaves.size());
+  state.pollCountdown = 1;
+  if(failingSets) {
+    state.failing.resize(numQueryVertices * numWords);
+    state.succeeded.resize(numQueryVertices);
+  }
+  size_t maxCandidateSize = 0;
+  for(size_t u = 0; u < numQueryVertices; ++u)
+    maxCandidateSize = std::max(maxCandidateSize, cs.GetCandidateSize(u));
+  state.scratch.resize(maxCandidateSize + kIntersectionPadding);
+  // a full batch and the row that fills it, so that emitting never allocates
+  if(emitEmbeddings)
+    state.batch.reserve(kOutputBatchSize + numQueryVertices);
+  for(size_t u = 0; u < numQueryVertices; ++u) {
+    // leaves get one parent too many, so that the core search never picks
+    // them
+    state.unmappedParents[u] = dag.GetNumParents(u) + isLeaf[u];
+    // intersection kernels may write past the end of their result
+    state.extendable[u].resize(cs.GetCandidateSize(u) + kIntersectionPadding);
+    if(state.unmappedParents[u] == 0) {
+      state.ready[u >> 6] |= uint64_t(1) << (u & 63);
+      state.extendableSize[u] = computeExtendable(cs, space, dag, state, u);
+    }
+  }
+}
 
-  size_t val = 1; // total number of routes to check
-  size_t accum = 0; // total number of candidates
-  for(Vertex v = 0; v < query.GetNumVertices(); v++) {
-    val *= cs.GetCandidateSize(v);
-    accum += cs.GetCandidateSize(v);
+void Backtrack::runWorker(const Graph &data, const CandidateSet &cs,
+                 const DAG& dag, const CandidateSpace& space,
+                 TaskQueue& queue, size_t workerId) {
+  SearchState& state = states[workerId];
+  initState(data, cs, dag, space, state);
+
+  PROFILE(uint64_t isNeighborCalls = num_is_neighbor_calls);
+  bool idle = false;
+  SearchTask task;
+  // a suspended search leaves the queued tasks where they are
+  while(!stop.load(std::memory_order_relaxed) && !isSuspended()) {
+    if(queue.Pop(workerId, task) || queue.Steal(workerId, task)) {
+      if(idle) {
+        --idleWorkers;
+        idle = false;
+      }
+      // the kernels for up to 64, 128 and 256 query vertices know the
+      // length of the query vertex sets at compile time
+      switch(numWords) {
+        case 1: doCheck<1>(data, cs, dag, space, state, task, queue, workerId); break;
+        case 2: doCheck<2>(data, cs, dag, space, state, task, queue, workerId); break;
+        case 4: doCheck<4>(data, cs, dag, space, state, task, queue, workerId); break;
+        default: doCheck<0>(data, cs, dag, space, state, task, queue, workerId);
+      }
+      queue.Finish();
+      continue;
+    }
+    if(queue.GetNumOutstanding() == 0) break;
+    if(!idle) {
+      ++idleWorkers;
+      idle = true;
+    }
+    std::this_thread::yield();
   }
+  if(idle) --idleWorkers;
+  PROFILE(state.profile.is_neighbor_calls += num_is_neighbor_calls - isNeighborCalls);
 
-  #ifdef TRACE_DBG
-  std::cout << "max combination:" << val << " accum:" << accum << std::endl;
-  #endif
+  flushOutput(state);
+}
 
-  std::vector<Vertex> remains;
-  remains.clear(); // visited vertex while build()
-  remains.push_back(0);
-  size_t pointer = 0;
-  build(query, dag, remains, pointer);
+size_t Backtrack::PrintAllMatches(const Graph &data, const Graph &query, CandidateSet &cs) {
+  TextSink text(STDOUT_FILENO);
+  return Run(data, query, cs, MatchOptions(), text).num_matches;
+}
+
+void Backtrack::configure(const Graph &data, const Graph &query,
+                          const DAG& dag, const MatchOptions &options,
+                          std::chrono::steady_clock::time_point start) {
+  successCount = 0;
+  stop = false;
+  stopStatus = static_cast<int>(MatchStatus::kExhausted);
+  idleWorkers = 0;
+  originalIds = data.GetOriginalIds();
+  matchLimit = options.first_match_only ? std::min<size_t>(options.limit, 1) : options.limit;
+  cancel = options.cancel;
+  suspend = options.suspend;
+  pending.clear();
+  hasDeadline = options.time_budget_ms > 0;
+  deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double, std::milli>(options.time_budget_ms));
+  numWords = (query.GetNumVertices() + 63) / 64;
+  if(numWords == 3)
+    numWords = 4;
+  failingSets = options.failing_sets;
+  if(failingSets)
+    computeAncestors(dag);
+}
 
-  std::vector<Vertex> result; // 
-  result.assign(query.GetNumVertices(), -1);
-  std::vector<Vertex> order; 
+MatchStats Backtrack::Run(const Graph &data, const Graph &query, const CandidateSet &cs,
+                          const MatchOptions &options, ResultSink &sink) {
+  auto start = std::chrono::steady_clock::now();
+  MatchStats stats;
 
-  buildOrder(result, dag, order, 0);
-  for(size_t i = 0;i < result.size(); ++i) {
-    result[i] = -1;
+  sink.Begin(query.GetNumVertices());
+  if(query.GetNumVertices() == 0) {
+    sink.End(0);
+    return stats;
   }
-  
-  std::unordered_map<Vertex, Vertex> vtxConvMap;
-  std::unordered_map<Vertex, Vertex> vtxRevConvMap;
-  std::vector<int> matchingArray;
-  std::vector<int> visitedMap;
-  int acc = buildMatchingArray(query, cs, vtxConvMap, vtxRevConvMap, matchingArray, visitedMap);
-  successCount = 0;
-  doCheck(data, cs, result, dag, order, visitedMap, vtxRevConvMap, matchingArray, acc);
-  std::cout << std::endl;
+
+  if(options.leaf_decomposition)
+    findLeaves(query);
+  else
+    isLeaf.assign(query.GetNumVertices(), 0);
+  // a cached plan comes with its DAG, symmetries and candidate space; those
+  // of an uncached query alone live in its arena
+  QueryPlan* plan = nullptr;
+  if(options.plan_cache != nullptr)
+    plan = &options.plan_cache->Find(data, query, options);
+  stats.plan_cached = plan != nullptr && plan->root >= 0;
+  DAG queryDag(&arena);
+  CandidateSpace querySpace(&arena);
+  DAG& dag = plan != nullptr ? plan->dag : queryDag;
+  SymmetryBreaker& breaker = plan != nullptr ? plan->symmetry : querySymmetry;
+  Vertex root = stats.plan_cached ? plan->root : SelectRoot(query, cs, &isLeaf);
+  if(!stats.plan_cached)
+    dag.Build(query, root);
+  groupLeaves(query, cs, dag);
+  if(!stats.plan_cached) {
+    if(options.symmetry_breaking)
+      breaker.Build(query, isLeaf, &arena);
+    else
+      breaker.Clear(query.GetNumVertices());
+    if(plan != nullptr) {
+      plan->root = root;
+      options.plan_cache->Store(*plan);
+    }
+  }
+  symmetry = &breaker;
+  stats.num_root_candidates = cs.GetCandidateSize(root);
+
+  const CandidateSpace& space = plan != nullptr
+      ? options.plan_cache->GetSpace(*plan, data, query, cs) : querySpace;
+  if(plan == nullptr)
+    querySpace.Build(data, query, cs, dag);
+  configure(data, query, dag, options, start);
+  if(options.resume != nullptr)
+    successCount = options.resume->num_matches;
+  this->sink = &sink;
+  emitEmbeddings = sink.NeedsEmbeddings();
+  PROFILE(profile.Clear(query.GetNumVertices()));
+  for(SearchState& state : states) {
+    state.nodes = 0;
+    PROFILE(state.profile.Clear(query.GetNumVertices()));
+  }
+  stats.setup_ms = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start).count();
+
+  if(successCount >= matchLimit) {
+    stopStatus = static_cast<int>(MatchStatus::kLimit);
+  } else {
+    // the whole search tree is one task at first, split while workers are
+    // idle, unless the search goes on from a checkpoint
+    TaskQueue queue(numThreads);
+    if(options.resume != nullptr) {
+      for(size_t i = 0; i < options.resume->tasks.size(); ++i)
+        queue.Push(i % numThreads, SearchTask(options.resume->tasks[i]));
+    } else {
+      // within the candidates of the root, as a checkpoint of it must be
+      SearchTask rootTask;
+      rootTask.end = std::min(options.root_end, stats.num_root_candidates);
+      rootTask.begin = std::min(options.root_begin, rootTask.end);
+      queue.Push(0, std::move(rootTask));
+    }
+
+    // counts the workers too, as they are started after it
+    PROFILE(PerfCounters perf);
+    PROFILE(perf.Start());
+    std::vector<std::thread> workers;
+    for(size_t i = 1; i < numThreads; ++i)
+      workers.emplace_back(&Backtrack::runWorker, this, std::cref(data), std::cref(cs),
+                           std::cref(dag), std::cref(space), std::ref(queue), i);
+    runWorker(data, cs, dag, space, queue, 0);
+    for(auto& worker : workers)
+      worker.join();
+    if(stopStatus == static_cast<int>(MatchStatus::kExhausted) && isSuspended()) {
+      SearchTask task;
+      for(size_t i = 0; i < numThreads; ++i)
+        while(queue.Pop(i, task))
+          pending.push_back(std::move(task));
+      if(!pending.empty())
+        stopStatus = static_cast<int>(MatchStatus::kSuspended);
+    }
+#ifdef SEARCH_PROFILE
+    perf.Stop();
+    for(size_t i = 0; i < perf.GetNumEvents(); ++i)
+      profile.events.emplace_back(perf.GetEventName(i), perf.GetValue(i));
+#endif
+  }
+
+#ifdef SEARCH_PROFILE
+  for(size_t i = 0; i < numThreads; ++i)
+    profile.Merge(states[i].profile);
+  for(size_t u = 0; u < query.GetNumVertices(); ++u) {
+    profile.num_candidates[u] = cs.GetCandidateSize(u);
+    profile.is_leaf[u] = isLeaf[u];
+  }
+  profile.root = dag.GetOrder()[0];
+#endif
+
+  stats.num_matches = std::min(successCount.load(), matchLimit);
+  stats.status = static_cast<MatchStatus>(stopStatus.load());
+  if(options.checkpoint != nullptr && stats.status == MatchStatus::kSuspended) {
+    options.checkpoint->SetSearch(data, query, cs, options);
+    options.checkpoint->num_matches = stats.num_matches;
+    options.checkpoint->tasks = std::move(pending);
+  }
+  pending.clear();
+  for(size_t i = 0; i < numThreads; ++i)
+    stats.num_nodes += states[i].nodes;
+  if(stats.num_matches > 0)
+    stats.first_match_ms = std::chrono::duration<double, std::milli>(
+        firstMatch - start).count();
+  sink.End(stats.num_matches);
+  this->sink = nullptr;
+  originalIds = nullptr;
+  cancel = nullptr;
+  suspend = nullptr;
+  symmetry = nullptr;
+
+  // the query is done: dag and space only give their memory back to the
+  // arena, which frees all of it at once
+  stats.arena_allocations = arena.GetNumAllocations();
+  stats.arena_bytes = arena.GetNumBytes();
+  stats.heap_blocks = arena.GetNumHeapBlocks();
+  arena.Reset();
+
+  stats.elapsed_ms = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start).count();
+  return stats;
+}
+
+void Backtrack::beginIteration(const Graph &data, const Graph &query,
+                               const CandidateSet &cs, DAG& dag,
+                               CandidateSpace& space,
+                               const MatchOptions &options) {
+  auto start = std::chrono::steady_clock::now();
+  size_t numQueryVertices = query.GetNumVertices();
+  // leaves matched together and embeddings derived from a symmetric one
+  // come several at a time, so every query vertex is searched for
+  isLeaf.assign(numQueryVertices, 0);
+  iterationStarted = false;
+  iterationDone = numQueryVertices == 0;
+  iterationDepth = 0;
+  iterationRootBegin = options.root_begin;
+  iterationRootEnd = options.root_end;
+  iterationRow.assign(numQueryVertices, -1);
+  if(iterationDone) return;
+
+  dag.Build(query, SelectRoot(query, cs, &isLeaf));
+  groupLeaves(query, cs, dag);
+  querySymmetry.Clear(numQueryVertices);
+  symmetry = &querySymmetry;
+  space.Build(data, query, cs, dag);
+  configure(data, query, dag, options, start);
+  // a pulled search is suspended by not pulling
+  suspend = nullptr;
+  SearchState& state = states[0];
+  state.nodes = 0;
+  PROFILE(state.profile.Clear(numQueryVertices));
+  initState(data, cs, dag, space, state);
+}
+
+template <size_t W>
+bool Backtrack::resumeSearch(const CandidateSet &cs, const DAG& dag,
+                             const CandidateSpace& space) {
+  SearchState& state = states[0];
+  if(!iterationStarted) {
+    iterationStarted = true;
+    openDepth<W>(state, 0, iterationRootBegin, iterationRootEnd);
+  } else {
+    // go on from the embedding handed out last, with the next candidate of
+    // the last query vertex
+    unmapVertex(dag, state, state.order[--iterationDepth]);
+    if(failingSets)
+      state.succeeded[iterationDepth] = 1;
+  }
+  return searchLoop<W>(cs, dag, space, state, 0, iterationDepth, nullptr, 0, true);
+}
+
+const Vertex* Backtrack::nextMatch(const CandidateSet &cs, const DAG& dag,
+                                   const CandidateSpace& space) {
+  if(iterationDone) return nullptr;
+  if(successCount.load() >= matchLimit) {
+    stopSearch(MatchStatus::kLimit);
+    endIteration(dag);
+    return nullptr;
+  }
+  bool found;
+  switch(numWords) {
+    case 1: found = resumeSearch<1>(cs, dag, space); break;
+    case 2: found = resumeSearch<2>(cs, dag, space); break;
+    case 4: found = resumeSearch<4>(cs, dag, space); break;
+    default: found = resumeSearch<0>(cs, dag, space);
+  }
+  if(!found) {
+    endIteration(dag);
+    return nullptr;
+  }
+  ++successCount;
+  const std::vector<Vertex>& result = states[0].result;
+  for(size_t u = 0; u < result.size(); ++u)
+    iterationRow[u] = originalIds != nullptr ? originalIds[result[u]] : result[u];
+  return iterationRow.data();
+}
+
+void Backtrack::endIteration(const DAG& dag) {
+  if(iterationDone) return;
+  // release whatever is still mapped, which leaves visited all zero
+  SearchState& state = states[0];
+  while(iterationDepth > 0)
+    unmapVertex(dag, state, state.order[--iterationDepth]);
+  iterationDone = true;
+  symmetry = nullptr;
+  originalIds = nullptr;
+  cancel = nullptr;
 }
@@ -5,10 +5,14 @@
 
 #include "candidate_set.h"
 
+#include "dag.h"
+#include "graph.h"
+#include "text_reader.h"
+
 CandidateSet::CandidateSet(const std::string& filename) {
-  std::ifstream fin(filename);
+  TextReader fin(filename);
 
-  if (!fin.is_open()) {
+  if (!fin.IsOpen()) {
     std::cout << "Candidate set file " << filename << " not found!\n";
     exit(EXIT_FAILURE);
   }
@@ -16,28 +20,187 @@ CandidateSet::CandidateSet(const std::string& filename) {
   char type;
   size_t num_query_vertices;
 
-  fin >> type >> num_query_vertices;
+  fin.ReadChar(type);
+  fin.ReadInt(num_query_vertices);
 
-  cs_.resize(num_query_vertices);
+  offset_.assign(num_query_vertices, 0);
+  size_.assign(num_query_vertices, 0);
 
-  while (fin >> type) {
+  while (fin.ReadChar(type)) {
     if (type == 'c') {
       Vertex id;
       size_t candidate_set_size;
 
-      fin >> id >> candidate_set_size;
+      fin.ReadInt(id);
+      fin.ReadInt(candidate_set_size);
 
-      cs_[id].resize(candidate_set_size);
+      offset_[id] = candidates_.size();
+      size_[id] = candidate_set_size;
+      candidates_.resize(candidates_.size() + candidate_set_size);
 
       for (size_t i = 0; i < candidate_set_size; ++i) {
         Vertex data_vertex;
-        fin >> data_vertex;
-        cs_[id][i] = data_vertex;
+        fin.ReadInt(data_vertex);
+        candidates_[offset_[id] + i] = data_vertex;
       }
     }
   }
+}
 
-  fin.close();
+/**
+ * @brief Reads a candidate set file written against the ids of the data graph
+ * file, and translates it to the ids of data, which may have been reordered.
+ * The candidates of a reordered graph are sorted by their new id.
+ *
+ * @param filename
+ * @param data data graph.
+ */
+CandidateSet::CandidateSet(const std::string& filename, const Graph& data)
+    : CandidateSet(filename) {
+  if (!data.IsReordered()) return;
+  Vertex num_vertices = data.GetNumVertices();
+  for (size_t u = 0; u < size_.size(); ++u) {
+    Vertex* begin = candidates_.data() + offset_[u];
+    // ids the data graph does not have cannot be matched anyway
+    Vertex* end = std::remove_if(begin, begin + size_[u],
+                                 [num_vertices](Vertex v) {
+                                   return v < 0 || v >= num_vertices;
+                                 });
+    size_[u] = end - begin;
+    for (Vertex* v = begin; v != end; ++v) *v = data.GetInternalId(*v);
+    std::sort(begin, end);
+  }
 }
 
 CandidateSet::~CandidateSet() {}
+
+/**
+ * @brief Returns a hash of the candidates of every query vertex, in order,
+ * which tells apart the candidate sets a candidate space was built from.
+ *
+ * @return uint64_t
+ */
+uint64_t CandidateSet::ComputeFingerprint() const {
+  uint64_t hash = size_.size();
+  for (size_t u = 0; u < size_.size(); ++u) {
+    hash = HashCombine(hash, size_[u]);
+    for (size_t i = 0; i < size_[u]; ++i)
+      hash = HashCombine(hash, candidates_[offset_[u] + i]);
+  }
+  return hash;
+}
+
+/**
+ * @brief Builds the candidate set in process instead of reading the output of
+ * filter_vertices. Candidates are first filtered by label, degree and neighbor
+ * label frequency, then refined by DAG-graph DP as in DAF, alternating between
+ * the reversed query DAG and the query DAG until two passes in a row remove
+ * nothing.
+ *
+ * @param data data graph.
+ * @param query query graph.
+ * @param refine_steps maximum number of DAG-graph DP passes.
+ */
+CandidateSet::CandidateSet(const Graph& data, const Graph& query,
+                           size_t refine_steps) {
+  offset_.assign(query.GetNumVertices(), 0);
+  size_.assign(query.GetNumVertices(), 0);
+  FilterByNeighborhood(data, query);
+
+  if (query.GetNumVertices() == 0) return;
+
+  DAG dag;
+  dag.Build(query, SelectRoot(query, *this));
+
+  size_t unchanged = 0;
+  for (size_t step = 0; step < refine_steps && unchanged < 2; ++step) {
+    if (RefineByDAG(data, query, dag, step % 2 == 0))
+      unchanged = 0;
+    else
+      unchanged += 1;
+  }
+}
+
+void CandidateSet::FilterByNeighborhood(const Graph& data, const Graph& query) {
+  // data vertices bucketed by label
+  std::vector<size_t> label_offset(data.GetNumLabels() + 1, 0);
+  for (size_t v = 0; v < data.GetNumVertices(); ++v) {
+    label_offset[data.GetLabel(v) + 1] += 1;
+  }
+  for (size_t l = 0; l < data.GetNumLabels(); ++l) {
+    label_offset[l + 1] += label_offset[l];
+  }
+  std::vector<Vertex> by_label(data.GetNumVertices());
+  std::vector<size_t> cursor(label_offset.begin(), label_offset.end() - 1);
+  for (size_t v = 0; v < data.GetNumVertices(); ++v) {
+    by_label[cursor[data.GetLabel(v)]++] = v;
+  }
+
+  for (size_t u = 0; u < query.GetNumVertices(); ++u) {
+    Label l = query.GetLabel(u);
+    offset_[u] = candidates_.size();
+    if (l < 0) continue;
+
+    for (size_t i = label_offset[l]; i < label_offset[l + 1]; ++i) {
+      Vertex v = by_label[i];
+      if (data.GetDegree(v) < query.GetDegree(u)) continue;
+
+      // neighbors of u are sorted by label, so each label is checked once
+      bool pass = true;
+      for (size_t j = query.GetNeighborStartOffset(u);
+           j < query.GetNeighborEndOffset(u) && pass;) {
+        Label nl = query.GetLabel(query.GetNeighbor(j));
+        if (nl < 0) {
+          pass = false;
+          break;
+        }
+        size_t count = query.GetNeighborLabelFrequency(u, nl);
+        pass = data.GetNeighborLabelFrequency(v, nl) >= count;
+        j += count;
+      }
+
+      if (pass) candidates_.push_back(v);
+    }
+    size_[u] = candidates_.size() - offset_[u];
+  }
+}
+
+bool CandidateSet::RefineByDAG(const Graph& data, const Graph& query,
+                               const DAG& dag, bool bottom_up) {
+  // mark[w] == stamp iff w is in the candidate set of the neighbor being
+  // checked
+  std::vector<uint32_t> mark(data.GetNumVertices(), 0);
+  uint32_t stamp = 0;
+  bool changed = false;
+  const ArenaVector<Vertex>& order = dag.GetOrder();
+
+  for (size_t k = 0; k < order.size(); ++k) {
+    Vertex u = bottom_up ? order[order.size() - 1 - k] : order[k];
+    size_t num_neighbors =
+        bottom_up ? dag.GetNumChildren(u) : dag.GetNumParents(u);
+
+    for (size_t i = 0; i < num_neighbors; ++i) {
+      Vertex n = bottom_up ? dag.GetChild(u, i) : dag.GetParent(u, i);
+      Label l = query.GetLabel(n);
+      stamp += 1;
+      for (size_t j = 0; j < size_[n]; ++j)
+        mark[candidates_[offset_[n] + j]] = stamp;
+
+      // keep v only if some candidate of n is adjacent to it
+      Vertex* candidates = candidates_.data() + offset_[u];
+      size_t kept = 0;
+      for (size_t c = 0; c < size_[u]; ++c) {
+        Vertex v = candidates[c];
+        bool found = false;
+        for (size_t j = data.GetNeighborStartOffset(v, l);
+             j < data.GetNeighborEndOffset(v, l) && !found; ++j) {
+          found = mark[data.GetNeighbor(j)] == stamp;
+        }
+        if (found) candidates[kept++] = v;
+      }
+      changed |= kept < size_[u];
+      size_[u] = kept;
+    }
+  }
+  return changed;
+}
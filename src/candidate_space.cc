@@ -0,0 +1,86 @@
+/**
+ * @file candidate_space.cc
+ *
+ */
+
+#include "candidate_space.h"
+
+CandidateSpace::CandidateSpace(Arena* arena)
+    : edge_offset_(ArenaAllocator<size_t>(arena)),
+      list_base_(ArenaAllocator<size_t>(arena)),
+      list_offset_(ArenaAllocator<size_t>(arena)),
+      list_(ArenaAllocator<uint32_t>(arena)) {}
+
+/**
+ * @brief Builds the position lists of every DAG edge, replacing those of a
+ * previous Build().
+ *
+ * @param data data graph.
+ * @param query query graph.
+ * @param cs candidate set.
+ * @param dag query DAG.
+ */
+void CandidateSpace::Build(const Graph& data, const Graph& query,
+                           const CandidateSet& cs, const DAG& dag) {
+  size_t num_query_vertices = query.GetNumVertices();
+
+  edge_offset_.resize(num_query_vertices + 1);
+  edge_offset_[0] = 0;
+  for (size_t u = 0; u < num_query_vertices; ++u) {
+    edge_offset_[u + 1] = edge_offset_[u] + dag.GetNumParents(u);
+  }
+
+  list_base_.resize(edge_offset_[num_query_vertices]);
+  // one offset per candidate of every parent, reserved so that no buffer is
+  // left behind in the arena; list_ grows, and leaves behind less than its
+  // final size
+  size_t num_lists = 0;
+  for (size_t u = 0; u < num_query_vertices; ++u) {
+    for (size_t k = 0; k < dag.GetNumParents(u); ++k)
+      num_lists += cs.GetCandidateSize(dag.GetParent(u, k));
+  }
+  list_offset_.clear();
+  list_offset_.reserve(num_lists + 1);
+  list_offset_.push_back(0);
+  list_.clear();
+
+  // position of each data vertex in C(u) of the current child u, -1 otherwise
+  ArenaVector<int32_t> position(data.GetNumVertices(), -1,
+                                ArenaAllocator<int32_t>(list_.get_allocator()));
+
+  for (size_t u = 0; u < num_query_vertices; ++u) {
+    Label l = query.GetLabel(u);
+
+    for (size_t j = 0; j < cs.GetCandidateSize(u); ++j) {
+      position[cs.GetCandidate(u, j)] = j;
+    }
+
+    for (size_t k = 0; k < dag.GetNumParents(u); ++k) {
+      Vertex p = dag.GetParent(u, k);
+      list_base_[edge_offset_[u] + k] = list_offset_.size() - 1;
+
+      for (size_t i = 0; i < cs.GetCandidateSize(p); ++i) {
+        Vertex v = cs.GetCandidate(p, i);
+        size_t begin = list_.size();
+
+        if (l >= 0) {
+          size_t start = data.GetNeighborStartOffset(v, l);
+          size_t end = data.GetNeighborEndOffset(v, l);
+          for (size_t o = start; o < end; ++o) {
+            int32_t j = position[data.GetNeighbor(o)];
+            if (j >= 0) list_.push_back(j);
+          }
+        }
+
+        std::sort(list_.begin() + begin, list_.end());
+        list_offset_.push_back(list_.size());
+      }
+    }
+
+    for (size_t j = 0; j < cs.GetCandidateSize(u); ++j) {
+      position[cs.GetCandidate(u, j)] = -1;
+    }
+  }
+}
+
+CandidateSpace::~CandidateSpace() {}
@@ -0,0 +1,165 @@
+/**
+ * @file checkpoint.cc
+ *
+ */
+
+#include "checkpoint.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+// the version ends the magic; --resume rejects a checkpoint of another task
+// layout as it does one of another search
+const char kCheckpointMagic[8] = {'G', 'P', 'M', 'C', 'K', 'P', 'T', '1'};
+
+uint32_t GetPlanOptions(const MatchOptions& options) {
+  return options.leaf_decomposition | options.symmetry_breaking << 1;
+}
+
+template <typename T>
+void Write(std::ostream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool Read(std::istream& in, T& value) {
+  return static_cast<bool>(
+      in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+}  // namespace
+
+/**
+ * @brief Records the search the checkpoint is taken of.
+ *
+ * @param data data graph.
+ * @param query query graph.
+ * @param cs candidate set of query in data.
+ * @param options of the search.
+ */
+void Checkpoint::SetSearch(const Graph& data, const Graph& query,
+                           const CandidateSet& cs,
+                           const MatchOptions& options) {
+  data_fingerprint = data.GetFingerprint();
+  query_fingerprint = query.GetFingerprint();
+  candidate_fingerprint = cs.ComputeFingerprint();
+  plan_options = GetPlanOptions(options);
+}
+
+/**
+ * @brief Returns true if a search of query in data among the candidates of
+ * cs with options plans the same way as the one the checkpoint was taken
+ * of, so that it can be resumed from it, and its tasks fit that search: a
+ * position per depth above them, among the candidates of distinct query
+ * vertices, and a range within the candidates left at their depth.
+ *
+ * @return bool
+ */
+bool Checkpoint::IsSearch(const Graph& data, const Graph& query,
+                          const CandidateSet& cs,
+                          const MatchOptions& options) const {
+  if (data_fingerprint != data.GetFingerprint() ||
+      query_fingerprint != query.GetFingerprint() ||
+      candidate_fingerprint != cs.ComputeFingerprint() ||
+      plan_options != GetPlanOptions(options))
+    return false;
+  std::vector<bool> mapped_above(query.GetNumVertices());
+  for (const SearchTask& task : tasks) {
+    if (task.depth >= query.GetNumVertices() ||
+        task.prefix.size() != task.depth || task.begin > task.end)
+      return false;
+    // a query vertex at most once above the task, at one of its candidates
+    std::fill(mapped_above.begin(), mapped_above.end(), false);
+    for (const std::pair<Vertex, uint32_t>& mapped : task.prefix) {
+      if (mapped.first < 0 ||
+          static_cast<size_t>(mapped.first) >= query.GetNumVertices() ||
+          mapped_above[mapped.first] ||
+          mapped.second >= cs.GetCandidateSize(mapped.first))
+        return false;
+      mapped_above[mapped.first] = true;
+    }
+    // the range at the task depth is one of extendable candidates, a subset
+    // of the candidates of whichever vertex the plan matches there
+    size_t max_candidates = 0;
+    for (size_t u = 0; u < query.GetNumVertices(); ++u)
+      if (!mapped_above[u])
+        max_candidates = std::max(max_candidates, cs.GetCandidateSize(u));
+    if (task.end > max_candidates) return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Writes the checkpoint to filename, replacing the previous one only
+ * once the new one is complete.
+ *
+ * @param filename
+ * @return bool false if it could not be written; the previous one is left
+ * alone then.
+ */
+bool Checkpoint::Save(const std::string& filename) const {
+  std::string temporary_name = filename + ".tmp";
+  {
+    std::ofstream fout(temporary_name, std::ios::binary);
+    if (!fout.is_open()) return false;
+    fout.write(kCheckpointMagic, sizeof(kCheckpointMagic));
+    Write(fout, data_fingerprint);
+    Write(fout, query_fingerprint);
+    Write(fout, candidate_fingerprint);
+    Write(fout, plan_options);
+    Write(fout, num_matches);
+    Write(fout, static_cast<uint64_t>(tasks.size()));
+    for (const SearchTask& task : tasks) {
+      Write(fout, static_cast<uint64_t>(task.depth));
+      Write(fout, static_cast<uint64_t>(task.begin));
+      Write(fout, static_cast<uint64_t>(task.end));
+      // the prefix has depth entries
+      for (const std::pair<Vertex, uint32_t>& mapped : task.prefix) {
+        Write(fout, mapped.first);
+        Write(fout, mapped.second);
+      }
+    }
+    if (!fout) {
+      fout.close();
+      std::remove(temporary_name.c_str());
+      return false;
+    }
+  }
+  return std::rename(temporary_name.c_str(), filename.c_str()) == 0;
+}
+
+/**
+ * @brief Reads a checkpoint written by Save().
+ *
+ * @param filename
+ * @return bool false if there is none or it is not one.
+ */
+bool Checkpoint::Load(const std::string& filename) {
+  std::ifstream fin(filename, std::ios::binary);
+  char magic[sizeof(kCheckpointMagic)];
+  uint64_t num_tasks;
+  if (!fin.read(magic, sizeof(magic)) ||
+      memcmp(magic, kCheckpointMagic, sizeof(magic)) != 0 ||
+      !Read(fin, data_fingerprint) || !Read(fin, query_fingerprint) ||
+      !Read(fin, candidate_fingerprint) || !Read(fin, plan_options) ||
+      !Read(fin, num_matches) || !Read(fin, num_tasks))
+    return false;
+  tasks.clear();
+  for (uint64_t i = 0; i < num_tasks; ++i) {
+    uint64_t depth, begin, end;
+    if (!Read(fin, depth) || !Read(fin, begin) || !Read(fin, end) ||
+        depth > (1 << 20))
+      return false;
+    SearchTask task;
+    task.depth = depth;
+    task.begin = begin;
+    task.end = end;
+    task.prefix.resize(depth);
+    for (std::pair<Vertex, uint32_t>& mapped : task.prefix) {
+      if (!Read(fin, mapped.first) || !Read(fin, mapped.second)) return false;
+    }
+    tasks.push_back(std::move(task));
+  }
+  // nothing may follow the tasks, or the task counts are off
+  return fin.peek() == std::ifstream::traits_type::eof();
+}
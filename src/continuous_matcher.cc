@@ -0,0 +1,273 @@
+/**
+ * @file continuous_matcher.cc
+ *
+ */
+
+#include "continuous_matcher.h"
+
+/**
+ * @brief Starts from the edges of data.
+ *
+ * @param data data graph.
+ * @param limit most embeddings an update reports, over all queries.
+ */
+ContinuousMatcher::ContinuousMatcher(const Graph& data, size_t limit)
+    : graph_(data),
+      limit_(limit),
+      num_words_((data.GetNumVertices() + 63) / 64),
+      used_(num_words_, 0) {}
+
+/**
+ * @brief Registers query, whose embeddings the updates from now on report.
+ *
+ * @param query query graph, its labels those of the data graph. It need not
+ * outlive the call.
+ * @return size_t the query's id, in the order they were added.
+ */
+size_t ContinuousMatcher::AddQuery(const Graph& query) {
+  queries_.emplace_back();
+  Query& added = queries_.back();
+  size_t n = query.GetNumVertices();
+  added.num_vertices = n;
+  added.label.resize(n);
+  added.degree.resize(n);
+  added.nlf_offset.assign(n + 1, 0);
+  for (size_t u = 0; u < n; ++u) {
+    added.label[u] = query.GetLabel(u);
+    added.degree[u] = query.GetDegree(u);
+    // the neighbors are sorted by label, so each label is one run
+    for (size_t i = query.GetNeighborStartOffset(u);
+         i < query.GetNeighborEndOffset(u); ++i) {
+      Label l = query.GetLabel(query.GetNeighbor(i));
+      if (added.nlf.size() > added.nlf_offset[u] && added.nlf.back().first == l)
+        ++added.nlf.back().second;
+      else
+        added.nlf.emplace_back(l, 1);
+    }
+    added.nlf_offset[u + 1] = added.nlf.size();
+  }
+
+  added.candidate.assign(n * num_words_, 0);
+  for (size_t u = 0; u < n; ++u) {
+    Label l = added.label[u];
+    if (l < 0 || static_cast<size_t>(l) >= graph_.GetNumLabels()) continue;
+    for (const Vertex* it = graph_.GetVertexBegin(l);
+         it != graph_.GetVertexEnd(l); ++it) {
+      Vertex v = *it;
+      if (Fits(added, u, v))
+        added.candidate[u * num_words_ + (v >> 6)] |= uint64_t(1) << (v & 63);
+    }
+  }
+
+  for (size_t u = 0; u < n; ++u) {
+    for (size_t i = query.GetNeighborStartOffset(u);
+         i < query.GetNeighborEndOffset(u); ++i)
+      added.seeds.push_back(BuildSeedOrder(query, u, query.GetNeighbor(i)));
+  }
+
+  if (embedding_.size() < n) embedding_.resize(n, -1);
+  return queries_.size() - 1;
+}
+
+/**
+ * @brief Adds the edge (v, w) and reports the embeddings that use it.
+ *
+ * @param v data vertex id.
+ * @param w data vertex id.
+ * @param callback called with every new embedding, if not null.
+ * @return UpdateStats not applied if the edge was there already, a loop, or
+ * had an endpoint out of range.
+ */
+UpdateStats ContinuousMatcher::InsertEdge(Vertex v, Vertex w,
+                                          const Callback& callback) {
+  UpdateStats stats;
+  if (!graph_.InsertEdge(v, w)) return stats;
+  stats.applied = true;
+  UpdateCandidates(v);
+  UpdateCandidates(w);
+  Search(v, w, true, callback, stats);
+  return stats;
+}
+
+/**
+ * @brief Removes the edge (v, w) and reports the embeddings that used it.
+ *
+ * @param v data vertex id.
+ * @param w data vertex id.
+ * @param callback called with every destroyed embedding, if not null.
+ * @return UpdateStats not applied if there was no such edge.
+ */
+UpdateStats ContinuousMatcher::DeleteEdge(Vertex v, Vertex w,
+                                          const Callback& callback) {
+  UpdateStats stats;
+  if (!HasEdge(v, w)) return stats;
+  stats.applied = true;
+  // the embeddings to report are those of the graph before the update
+  Search(v, w, false, callback, stats);
+  graph_.DeleteEdge(v, w);
+  UpdateCandidates(v);
+  UpdateCandidates(w);
+  return stats;
+}
+
+/**
+ * @brief Returns the number of candidates of query vertex u as of the last
+ * update.
+ *
+ * @param query id from AddQuery().
+ * @param u query vertex id.
+ * @return size_t
+ */
+size_t ContinuousMatcher::GetNumCandidates(size_t query, Vertex u) const {
+  const uint64_t* candidate = &queries_[query].candidate[u * num_words_];
+  size_t count = 0;
+  for (size_t i = 0; i < num_words_; ++i)
+    count += __builtin_popcountll(candidate[i]);
+  return count;
+}
+
+ContinuousMatcher::SeedOrder ContinuousMatcher::BuildSeedOrder(
+    const Graph& query, Vertex first, Vertex second) {
+  // then the vertex with the most neighbors mapped, the higher degree on
+  // ties, so that every vertex but those of other components has a parent
+  size_t n = query.GetNumVertices();
+  SeedOrder seed;
+  std::vector<size_t> position(n, SIZE_MAX);
+  std::vector<size_t> num_mapped_neighbors(n, 0);
+  auto place = [&](Vertex u) {
+    position[u] = seed.order.size();
+    seed.order.push_back(u);
+    for (size_t i = query.GetNeighborStartOffset(u);
+         i < query.GetNeighborEndOffset(u); ++i)
+      ++num_mapped_neighbors[query.GetNeighbor(i)];
+  };
+  place(first);
+  place(second);
+  while (seed.order.size() < n) {
+    Vertex next = -1;
+    for (size_t u = 0; u < n; ++u) {
+      if (position[u] != SIZE_MAX) continue;
+      if (next < 0 || num_mapped_neighbors[u] > num_mapped_neighbors[next] ||
+          (num_mapped_neighbors[u] == num_mapped_neighbors[next] &&
+           query.GetDegree(u) > query.GetDegree(next)))
+        next = u;
+    }
+    place(next);
+  }
+
+  seed.parent.assign(n, -1);
+  seed.check_offset.assign(n + 1, 0);
+  for (size_t d = 0; d < n; ++d) {
+    Vertex u = seed.order[d];
+    std::vector<Vertex> before;
+    for (size_t i = query.GetNeighborStartOffset(u);
+         i < query.GetNeighborEndOffset(u); ++i) {
+      Vertex w = query.GetNeighbor(i);
+      if (position[w] < d) before.push_back(w);
+    }
+    std::sort(before.begin(), before.end(), [&position](Vertex a, Vertex b) {
+      return position[a] < position[b];
+    });
+    // the seed edge itself needs no check
+    if (d >= 2 && !before.empty()) {
+      seed.parent[d] = before[0];
+      seed.check.insert(seed.check.end(), before.begin() + 1, before.end());
+    }
+    seed.check_offset[d + 1] = seed.check.size();
+  }
+  return seed;
+}
+
+bool ContinuousMatcher::Fits(const Query& query, Vertex u, Vertex v) const {
+  if (graph_.GetLabel(v) != query.label[u] ||
+      graph_.GetDegree(v) < query.degree[u])
+    return false;
+  for (size_t k = query.nlf_offset[u]; k < query.nlf_offset[u + 1]; ++k) {
+    std::pair<const Vertex*, const Vertex*> neighbors =
+        graph_.GetNeighbors(v, query.nlf[k].first);
+    if (static_cast<size_t>(neighbors.second - neighbors.first) <
+        query.nlf[k].second)
+      return false;
+  }
+  return true;
+}
+
+void ContinuousMatcher::UpdateCandidates(Vertex v) {
+  uint64_t bit = uint64_t(1) << (v & 63);
+  for (Query& query : queries_) {
+    for (size_t u = 0; u < query.num_vertices; ++u) {
+      if (query.label[u] != graph_.GetLabel(v)) continue;
+      uint64_t& word = query.candidate[u * num_words_ + (v >> 6)];
+      word = Fits(query, u, v) ? word | bit : word & ~bit;
+    }
+  }
+}
+
+bool ContinuousMatcher::HasEdge(Vertex v, Vertex w) const {
+  return v >= 0 && w >= 0 && static_cast<size_t>(v) < graph_.GetNumVertices() &&
+         static_cast<size_t>(w) < graph_.GetNumVertices() && v != w &&
+         graph_.IsNeighbor(v, w);
+}
+
+void ContinuousMatcher::Search(Vertex v, Vertex w, bool inserted,
+                               const Callback& callback, UpdateStats& stats) {
+  used_[v >> 6] |= uint64_t(1) << (v & 63);
+  used_[w >> 6] |= uint64_t(1) << (w & 63);
+  for (size_t id = 0; id < queries_.size() && !stats.truncated; ++id) {
+    const Query& query = queries_[id];
+    for (const SeedOrder& seed : query.seeds) {
+      // both directions of the update are tried, as every query edge has a
+      // seed per direction
+      Vertex first = seed.order[0];
+      Vertex second = seed.order[1];
+      if (!IsCandidate(query, first, v) || !IsCandidate(query, second, w))
+        continue;
+      embedding_[first] = v;
+      embedding_[second] = w;
+      stats.num_nodes += 2;
+      Extend(id, seed, 2, inserted, callback, stats);
+      if (stats.truncated) break;
+    }
+  }
+  used_[v >> 6] &= ~(uint64_t(1) << (v & 63));
+  used_[w >> 6] &= ~(uint64_t(1) << (w & 63));
+}
+
+void ContinuousMatcher::Extend(size_t id, const SeedOrder& seed, size_t depth,
+                               bool inserted, const Callback& callback,
+                               UpdateStats& stats) {
+  const Query& query = queries_[id];
+  if (depth == query.num_vertices) {
+    if (stats.num_matches == limit_) {
+      stats.truncated = true;
+      return;
+    }
+    ++stats.num_matches;
+    if (callback) callback(id, inserted, embedding_.data(), query.num_vertices);
+    return;
+  }
+
+  Vertex u = seed.order[depth];
+  Label l = query.label[u];
+  if (l < 0 || static_cast<size_t>(l) >= graph_.GetNumLabels()) return;
+  std::pair<const Vertex*, const Vertex*> candidates =
+      seed.parent[depth] >= 0
+          ? graph_.GetNeighbors(embedding_[seed.parent[depth]], l)
+          : std::make_pair(graph_.GetVertexBegin(l), graph_.GetVertexEnd(l));
+  for (const Vertex* it = candidates.first; it != candidates.second; ++it) {
+    Vertex v = *it;
+    if ((used_[v >> 6] >> (v & 63)) & 1 || !IsCandidate(query, u, v)) continue;
+    bool adjacent = true;
+    for (size_t k = seed.check_offset[depth];
+         k < seed.check_offset[depth + 1] && adjacent; ++k)
+      adjacent = graph_.IsNeighbor(embedding_[seed.check[k]], v);
+    if (!adjacent) continue;
+
+    embedding_[u] = v;
+    used_[v >> 6] |= uint64_t(1) << (v & 63);
+    ++stats.num_nodes;
+    Extend(id, seed, depth + 1, inserted, callback, stats);
+    used_[v >> 6] &= ~(uint64_t(1) << (v & 63));
+    if (stats.truncated) return;
+  }
+}
@@ -0,0 +1,97 @@
+/**
+ * @file dag.cc
+ *
+ */
+
+#include "dag.h"
+
+Vertex SelectRoot(const Graph& query, const CandidateSet& cs,
+                  const std::vector<uint8_t>* excluded) {
+  // the vertex with the fewest candidates per incident edge
+  Vertex root = 0;
+  for(size_t u = 1; u < query.GetNumVertices(); ++u) {
+    if(excluded != nullptr && (*excluded)[u] && !(*excluded)[root]) continue;
+    if(excluded != nullptr && (*excluded)[root] && !(*excluded)[u]) {
+      root = u;
+      continue;
+    }
+    size_t degU = std::max<size_t>(query.GetDegree(u), 1);
+    size_t degRoot = std::max<size_t>(query.GetDegree(root), 1);
+    if(cs.GetCandidateSize(u) * degRoot < cs.GetCandidateSize(root) * degU)
+      root = u;
+  }
+  return root;
+}
+
+DAG::DAG(Arena* arena)
+    : offset_(ArenaAllocator<size_t>(arena)),
+      adjacency_(ArenaAllocator<Vertex>(arena)),
+      order_(ArenaAllocator<Vertex>(arena)),
+      visit_index_(ArenaAllocator<size_t>(arena)) {}
+
+/**
+ * @brief Builds the query DAG by BFS from root. Every query edge points from
+ * the endpoint visited first to the other one.
+ *
+ * @param graph query graph.
+ * @param root
+ */
+void DAG::Build(const Graph& graph, Vertex root) {
+  // BFS from root, every query edge points from the earlier visited endpoint
+  // to the later one
+  size_t numVertices = graph.GetNumVertices();
+  ArenaVector<size_t>& visitIdx = visit_index_;
+  ArenaVector<Vertex>& remains = order_;
+  visitIdx.assign(numVertices, SIZE_MAX);
+  remains.clear();
+
+  for(size_t start = 0; start <= numVertices; ++start) {
+    // root first, then any vertex left in another component
+    Vertex s = start == 0 ? root : static_cast<Vertex>(start - 1);
+    if(numVertices == 0 || visitIdx[s] != SIZE_MAX) continue;
+    visitIdx[s] = remains.size();
+    remains.push_back(s);
+
+    for(size_t pointer = visitIdx[s]; pointer < remains.size(); ++pointer) {
+      Vertex id = remains[pointer];
+      for(size_t i = graph.GetNeighborStartOffset(id); i < graph.GetNeighborEndOffset(id); ++i) {
+        Vertex v = graph.GetNeighbor(i);
+        if(visitIdx[v] == SIZE_MAX) {
+          visitIdx[v] = remains.size();
+          remains.push_back(v);
+        }
+      }
+    }
+  }
+
+  // an edge is a parent slot of its later endpoint and a child slot of the
+  // earlier one
+  offset_.assign(2 * numVertices + 1, 0);
+  for(size_t id = 0; id < numVertices; ++id) {
+    for(size_t i = graph.GetNeighborStartOffset(id); i < graph.GetNeighborEndOffset(id); ++i) {
+      Vertex v = graph.GetNeighbor(i);
+      if(visitIdx[id] < visitIdx[v])
+        ++offset_[2 * id + 2];
+      else
+        ++offset_[2 * id + 1];
+    }
+  }
+  for(size_t i = 0; i < 2 * numVertices; ++i)
+    offset_[i + 1] += offset_[i];
+
+  // filled in BFS order, so parents are sorted by visit order
+  adjacency_.resize(offset_[2 * numVertices]);
+  ArenaVector<size_t> nextParent(numVertices, 0, offset_.get_allocator());
+  for(size_t id = 0; id < numVertices; ++id)
+    nextParent[id] = offset_[2 * id];
+  for(Vertex id : remains) {
+    size_t nextChild = offset_[2 * id + 1];
+    for(size_t i = graph.GetNeighborStartOffset(id); i < graph.GetNeighborEndOffset(id); ++i) {
+      Vertex v = graph.GetNeighbor(i);
+      if(visitIdx[id] < visitIdx[v]) {
+        adjacency_[nextChild++] = v;
+        adjacency_[nextParent[v]++] = id;
+      }
+    }
+  }
+}
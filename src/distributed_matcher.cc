@@ -0,0 +1,347 @@
+/**
+ * @file distributed_matcher.cc
+ *
+ */
+
+#include "distributed_matcher.h"
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <poll.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+// coordinator to worker: the root candidate positions to try; the worker
+// exits when the socket is closed instead
+struct SliceMessage {
+  uint64_t begin;
+  uint64_t end;
+  uint64_t limit;         // what is left of the match limit
+  double time_budget_ms;  // what is left of the time budget, 0 for none
+};
+
+// worker to coordinator: num_rows embeddings follow a kRows message
+enum ReportKind : uint64_t { kRows, kDone };
+struct ReportMessage {
+  uint64_t kind;
+  uint64_t num_rows;  // of a kDone message, the matches of the slice
+  uint64_t num_nodes;
+  uint64_t status;
+};
+
+bool WriteAll(int fd, const void* data, size_t size) {
+  const char* bytes = static_cast<const char*>(data);
+  while (size > 0) {
+    // a worker killed meanwhile must not take the coordinator with it
+    ssize_t written = send(fd, bytes, size, MSG_NOSIGNAL);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    bytes += written;
+    size -= written;
+  }
+  return true;
+}
+
+bool ReadAll(int fd, void* data, size_t size) {
+  char* bytes = static_cast<char*>(data);
+  while (size > 0) {
+    ssize_t got = read(fd, bytes, size);
+    if (got < 0 && errno == EINTR) continue;
+    if (got <= 0) return false;
+    bytes += got;
+    size -= got;
+  }
+  return true;
+}
+
+/**
+ * @brief Sends the matches of a worker to the coordinator.
+ */
+class SocketSink : public ResultSink {
+ public:
+  SocketSink(int fd, bool needs_embeddings)
+      : fd_(fd), needs_embeddings_(needs_embeddings) {}
+
+  void Begin(size_t num_query_vertices) override {
+    row_size_ = num_query_vertices;
+  }
+  void Consume(const Vertex* rows, size_t num_rows) override {
+    ReportMessage message = {kRows, num_rows, 0, 0};
+    // nobody is left to report to
+    if (!WriteAll(fd_, &message, sizeof(message)) ||
+        !WriteAll(fd_, rows, num_rows * row_size_ * sizeof(Vertex)))
+      _exit(EXIT_FAILURE);
+  }
+  bool NeedsEmbeddings() const override { return needs_embeddings_; }
+
+ private:
+  int fd_;
+  bool needs_embeddings_;
+  size_t row_size_ = 0;
+};
+
+struct Worker {
+  pid_t pid = -1;
+  int fd = -1;
+  bool busy = false;  // a slice is out
+  bool dead = false;  // its socket failed, it gets no more slices
+};
+}  // namespace
+
+/**
+ * @brief Makes a coordinator for num_workers worker processes.
+ *
+ * @param num_workers at least 1.
+ * @param num_threads search threads of every worker.
+ */
+DistributedMatcher::DistributedMatcher(size_t num_workers, size_t num_threads)
+    : num_workers_(std::max<size_t>(num_workers, 1)),
+      num_threads_(num_threads) {}
+
+/**
+ * @brief Finds the embeddings of query in data among the candidates of cs
+ * with the worker processes, and hands them to sink. The workers are forked
+ * for the query and gone when it returns; if none can be, the query is
+ * searched in this process.
+ *
+ * @return MatchStats the nodes of all workers, and the setup of the
+ * coordinator. The status is kFailed when a worker died with a slice, or
+ * when every worker died before the root candidates were all handed out.
+ */
+MatchStats DistributedMatcher::Run(const Graph& data, const Graph& query,
+                                   const CandidateSet& cs,
+                                   const MatchOptions& options,
+                                   ResultSink& sink) {
+  auto start = std::chrono::steady_clock::now();
+  num_slices_ = 0;
+  num_lost_slices_ = 0;
+
+  // the plan is made before the fork, so that every worker finds it
+  MatchOptions worker_options = options;
+  if (worker_options.plan_cache == nullptr)
+    worker_options.plan_cache = &plan_cache_;
+  worker_options.cancel = nullptr;
+  // slices are not checkpointed
+  worker_options.suspend = nullptr;
+  worker_options.checkpoint = nullptr;
+  worker_options.resume = nullptr;
+  worker_options.first_match_only = false;
+  MatchOptions plan_options = worker_options;
+  plan_options.limit = 0;
+  CountSink none;
+  MatchStats stats;
+  {
+    Matcher planner;
+    MatchStats plan = planner.Run(data, query, cs, plan_options, none);
+    stats.plan_cached = plan.plan_cached;
+    stats.num_root_candidates = plan.num_root_candidates;
+  }
+  size_t limit = options.first_match_only ? std::min<size_t>(options.limit, 1)
+                                          : options.limit;
+  size_t num_rows = query.GetNumVertices();
+  bool needs_embeddings = sink.NeedsEmbeddings();
+
+  if (num_rows == 0 || stats.num_root_candidates == 0 || limit == 0) {
+    stats.status = limit == 0 && num_rows > 0 ? MatchStatus::kLimit
+                                              : MatchStatus::kExhausted;
+    sink.Begin(num_rows);
+    sink.End(0);
+    return stats;
+  }
+
+  std::vector<Worker> workers(num_workers_);
+  pid_t coordinator = getpid();
+  for (size_t i = 0; i < workers.size(); ++i) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) break;
+    pid_t pid = fork();
+    if (pid == 0) {
+      // a worker does not outlive a coordinator that was killed
+      prctl(PR_SET_PDEATHSIG, SIGKILL);
+      if (getppid() != coordinator) _exit(EXIT_FAILURE);
+      close(fds[0]);
+      for (size_t j = 0; j < i; ++j) close(workers[j].fd);
+      Serve(fds[1], data, query, cs, worker_options, needs_embeddings);
+    }
+    close(fds[1]);
+    if (pid < 0) {
+      close(fds[0]);
+      break;
+    }
+    workers[i].pid = pid;
+    workers[i].fd = fds[0];
+  }
+  while (!workers.empty() && workers.back().pid < 0) workers.pop_back();
+  if (workers.empty()) {
+    // no process could be started, the search stays in this one
+    Matcher matcher(num_threads_);
+    MatchOptions local_options = options;
+    local_options.plan_cache = worker_options.plan_cache;
+    MatchStats local = matcher.Run(data, query, cs, local_options, sink);
+    local.elapsed_ms = std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+    return local;
+  }
+  // after the fork, so that no buffered output is copied into the workers
+  sink.Begin(num_rows);
+  stats.setup_ms = std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  size_t total = stats.num_root_candidates;
+  size_t next = 0;  // the first root candidate not handed out
+  auto elapsed_ms = [&start]() {
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  };
+  // a slice of half an even share of what is left, so that the last slices
+  // are small enough to balance the end of the search
+  auto dispatch = [&](Worker& worker) {
+    if (next >= total) return false;
+    SliceMessage slice;
+    slice.begin = next;
+    slice.end = next + std::max<size_t>(
+                           1, (total - next) / (2 * workers.size()));
+    slice.limit = limit - stats.num_matches;
+    slice.time_budget_ms = 0;
+    if (options.time_budget_ms > 0) {
+      slice.time_budget_ms = options.time_budget_ms - elapsed_ms();
+      if (slice.time_budget_ms <= 0) {
+        stats.status = MatchStatus::kTimeout;
+        return false;
+      }
+    }
+    if (!WriteAll(worker.fd, &slice, sizeof(slice))) {
+      // died between slices; the others take the rest
+      worker.dead = true;
+      return false;
+    }
+    next = slice.end;
+    worker.busy = true;
+    ++num_slices_;
+    return true;
+  };
+
+  // hands out slices to the idle workers as long as there are any left
+  size_t num_busy = 0;
+  auto dispatch_idle = [&]() {
+    for (Worker& worker : workers)
+      if (!worker.busy && !worker.dead && dispatch(worker)) ++num_busy;
+  };
+  dispatch_idle();
+
+  bool stopping = false;
+  std::vector<Vertex> rows;
+  std::vector<pollfd> fds;
+  std::vector<Worker*> polled;
+  while (num_busy > 0 && !stopping) {
+    if (options.cancel != nullptr && options.cancel->load()) {
+      stats.status = MatchStatus::kCancelled;
+      break;
+    }
+    fds.clear();
+    polled.clear();
+    for (Worker& worker : workers) {
+      if (!worker.busy) continue;
+      fds.push_back({worker.fd, POLLIN, 0});
+      polled.push_back(&worker);
+    }
+    // wake up now and then for the cancellation flag
+    if (poll(fds.data(), fds.size(), 100) < 0 && errno != EINTR) break;
+
+    for (size_t i = 0; i < fds.size() && !stopping; ++i) {
+      if (fds[i].revents == 0) continue;
+      Worker& worker = *polled[i];
+      ReportMessage message;
+      if (!ReadAll(worker.fd, &message, sizeof(message))) {
+        // died in the middle of a slice
+        ++num_lost_slices_;
+        worker.busy = false;
+        worker.dead = true;
+        --num_busy;
+        continue;
+      }
+      size_t found = 0;
+      if (message.kind == kRows) {
+        rows.resize(message.num_rows * num_rows);
+        if (!ReadAll(worker.fd, rows.data(), rows.size() * sizeof(Vertex))) {
+          ++num_lost_slices_;
+          worker.busy = false;
+          worker.dead = true;
+          --num_busy;
+          continue;
+        }
+        found = std::min<size_t>(message.num_rows, limit - stats.num_matches);
+        sink.Consume(rows.data(), found);
+      } else {
+        worker.busy = false;
+        --num_busy;
+        stats.num_nodes += message.num_nodes;
+        // the matches of a slice came as rows already, unless only counted
+        if (!needs_embeddings)
+          found =
+              std::min<size_t>(message.num_rows, limit - stats.num_matches);
+        MatchStatus status = static_cast<MatchStatus>(message.status);
+        if (status == MatchStatus::kTimeout) {
+          stats.status = status;
+          stopping = true;
+        }
+      }
+      if (found > 0 && stats.num_matches == 0)
+        stats.first_match_ms = elapsed_ms();
+      stats.num_matches += found;
+      if (stats.num_matches == limit) {
+        stats.status = MatchStatus::kLimit;
+        stopping = true;
+      }
+      if (!stopping && !worker.busy) dispatch_idle();
+    }
+  }
+  // the embeddings of a lost slice, of one still out or of a range never
+  // handed out are missing
+  if (stats.status == MatchStatus::kExhausted &&
+      (num_lost_slices_ > 0 || num_busy > 0 || next < total))
+    stats.status = MatchStatus::kFailed;
+
+  // the rest of the search is not needed; the idle workers exit as their
+  // socket is closed
+  for (Worker& worker : workers) {
+    if (worker.busy) kill(worker.pid, SIGKILL);
+    close(worker.fd);
+  }
+  for (Worker& worker : workers) waitpid(worker.pid, nullptr, 0);
+
+  sink.End(stats.num_matches);
+  stats.elapsed_ms = elapsed_ms();
+  return stats;
+}
+
+void DistributedMatcher::Serve(int fd, const Graph& data, const Graph& query,
+                               const CandidateSet& cs,
+                               const MatchOptions& options,
+                               bool needs_embeddings) {
+  Matcher matcher(num_threads_);
+  SocketSink sink(fd, needs_embeddings);
+  SliceMessage slice;
+  while (ReadAll(fd, &slice, sizeof(slice))) {
+    MatchOptions slice_options = options;
+    slice_options.root_begin = slice.begin;
+    slice_options.root_end = slice.end;
+    slice_options.limit = slice.limit;
+    slice_options.time_budget_ms = slice.time_budget_ms;
+    MatchStats stats = matcher.Run(data, query, cs, slice_options, sink);
+    ReportMessage done = {kDone, stats.num_matches, stats.num_nodes,
+                          static_cast<uint64_t>(stats.status)};
+    if (!WriteAll(fd, &done, sizeof(done))) break;
+  }
+  // the buffers of the coordinator, copied by the fork, are not flushed
+  _exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,86 @@
+/**
+ * @file dynamic_graph.cc
+ *
+ */
+
+#include "dynamic_graph.h"
+
+/**
+ * @brief Copies the vertices, labels and edges of graph.
+ *
+ * @param graph
+ */
+DynamicGraph::DynamicGraph(const Graph& graph)
+    : num_edges_(graph.GetNumEdges()),
+      label_(graph.GetNumVertices()),
+      adjacency_(graph.GetNumVertices()) {
+  Label max_label = -1;
+  for (size_t v = 0; v < graph.GetNumVertices(); ++v)
+    max_label = std::max(max_label, graph.GetLabel(v));
+  vertex_offset_.assign(max_label + 2, 0);
+  for (size_t v = 0; v < graph.GetNumVertices(); ++v) {
+    label_[v] = graph.GetLabel(v);
+    // the neighbors of Graph are in the same order already
+    adjacency_[v].assign(graph.GetNeighborEndOffset(v) -
+                             graph.GetNeighborStartOffset(v), 0);
+    for (size_t i = graph.GetNeighborStartOffset(v);
+         i < graph.GetNeighborEndOffset(v); ++i)
+      adjacency_[v][i - graph.GetNeighborStartOffset(v)] =
+          graph.GetNeighbor(i);
+    // a vertex without a label cannot be matched, and is left out
+    if (label_[v] >= 0) ++vertex_offset_[label_[v] + 1];
+  }
+  for (size_t l = 0; l + 1 < vertex_offset_.size(); ++l)
+    vertex_offset_[l + 1] += vertex_offset_[l];
+  vertex_.resize(vertex_offset_.back());
+  std::vector<size_t> next(vertex_offset_.begin(), vertex_offset_.end() - 1);
+  for (size_t v = 0; v < graph.GetNumVertices(); ++v)
+    if (label_[v] >= 0) vertex_[next[label_[v]]++] = v;
+}
+
+/**
+ * @brief Adds the edge (v, w).
+ *
+ * @param v vertex id.
+ * @param w vertex id.
+ * @return bool false, and nothing changes, if the edge is there already, is
+ * a loop or has an endpoint out of range.
+ */
+bool DynamicGraph::InsertEdge(Vertex v, Vertex w) {
+  if (v == w || v < 0 || w < 0 || static_cast<size_t>(v) >= label_.size() ||
+      static_cast<size_t>(w) >= label_.size() || IsNeighbor(v, w))
+    return false;
+  auto precedes = [this](Vertex a, Vertex b) { return Precedes(a, b); };
+  std::vector<Vertex>& v_neighbors = adjacency_[v];
+  v_neighbors.insert(std::lower_bound(v_neighbors.begin(), v_neighbors.end(),
+                                      w, precedes),
+                     w);
+  std::vector<Vertex>& w_neighbors = adjacency_[w];
+  w_neighbors.insert(std::lower_bound(w_neighbors.begin(), w_neighbors.end(),
+                                      v, precedes),
+                     v);
+  ++num_edges_;
+  return true;
+}
+
+/**
+ * @brief Removes the edge (v, w).
+ *
+ * @param v vertex id.
+ * @param w vertex id.
+ * @return bool false, and nothing changes, if there is no such edge.
+ */
+bool DynamicGraph::DeleteEdge(Vertex v, Vertex w) {
+  if (v == w || v < 0 || w < 0 || static_cast<size_t>(v) >= label_.size() ||
+      static_cast<size_t>(w) >= label_.size() || !IsNeighbor(v, w))
+    return false;
+  auto precedes = [this](Vertex a, Vertex b) { return Precedes(a, b); };
+  std::vector<Vertex>& v_neighbors = adjacency_[v];
+  v_neighbors.erase(
+      std::lower_bound(v_neighbors.begin(), v_neighbors.end(), w, precedes));
+  std::vector<Vertex>& w_neighbors = adjacency_[w];
+  w_neighbors.erase(
+      std::lower_bound(w_neighbors.begin(), w_neighbors.end(), v, precedes));
+  --num_edges_;
+  return true;
+}
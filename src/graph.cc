@@ -5,163 +5,595 @@
 
 #include "graph.h"
 
-namespace {
-std::vector<Label> transferred_label;
-void TransferLabel(const std::string &filename) {
-  std::ifstream fin(filename);
-
-  if (!fin.is_open()) {
-    std::cout << "Graph file " << filename << " not found!\n";
-    exit(EXIT_FAILURE);
-  }
+#include "text_reader.h"
 
-  char type;
-  int32_t graph_id_;
-  size_t num_vertices_;
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-  std::set<Label> label_set;
+#include <cstring>
 
-  fin >> type >> graph_id_ >> num_vertices_;
+namespace {
+// builds the label remap table of a data graph from its raw labels
+std::vector<Label> TransferLabel(const std::vector<Label> &raw_labels) {
+  Label max_raw_label = -1;
+  for (Label l : raw_labels) max_raw_label = std::max(max_raw_label, l);
+
+  std::vector<bool> present(max_raw_label + 1, false);
+  for (Label l : raw_labels) {
+    if (l >= 0) present[l] = true;
+  }
 
-  // preprocessing
-  while (fin >> type) {
-    if (type == 'v') {
-      Vertex id;
-      Label l;
-      fin >> id >> l;
+  std::vector<Label> transferred_label(max_raw_label + 1, -1);
 
-      label_set.insert(l);
-    } else if (type == 'e') {
-      Vertex v1, v2;
-      Label l;
-      fin >> v1 >> v2 >> l;
+  Label new_label = 0;
+  for (Label l = 0; l <= max_raw_label; ++l) {
+    if (present[l]) {
+      transferred_label[l] = new_label;
+      new_label += 1;
     }
   }
+  return transferred_label;
+}
 
-  fin.close();
+// Binary CSR file layout. Every section starts at a multiple of 8 bytes.
+//   BinaryHeader
+//   size_t label_frequency[max_label + 1]
+//   size_t start_offset[num_vertices + 1]
+//   if dense_label_index:
+//     uint32_t label_prefix[num_vertices * (max_label + 2)]
+//   else:
+//     size_t label_segment_offset[num_vertices + 1]
+//     LabelSegment label_segment[num_label_segments]
+//   Label label[num_vertices]
+//   Vertex adj_array[num_edges * 2]
+//   Label transferred_label[num_transferred_labels]
+//   if reordered:
+//     Vertex original_id[num_vertices]
+// "GPMCSR" and the version of the layout above; a file of another version
+// is recognized as binary by the prefix, then rejected and has to be
+// converted again
+const char kBinaryMagic[8] = {'G', 'P', 'M', 'C', 'S', 'R', '5', '\0'};
+const size_t kBinaryMagicPrefix = 6;
+
+struct BinaryHeader {
+  char magic[8];
+  int32_t graph_id;
+  Label max_label;
+  uint64_t num_vertices;
+  uint64_t num_edges;
+  uint64_t num_labels;
+  uint64_t num_transferred_labels;
+  uint64_t num_label_segments;
+  uint64_t dense_label_index;
+  uint64_t reordered;
+  uint64_t fingerprint;
+};
+
+// label count up to which the label segments are kept in a dense table
+const size_t kMaxDenseLabels = 128;
+
+inline size_t AlignUp(size_t offset) { return (offset + 7) & ~size_t(7); }
+
+// true for a binary file of any format version
+bool IsBinaryGraph(const std::string &filename) {
+  std::ifstream fin(filename, std::ios::binary);
+  char magic[kBinaryMagicPrefix];
+  return fin.read(magic, sizeof(magic)) &&
+         memcmp(magic, kBinaryMagic, sizeof(magic)) == 0;
+}
+}  // namespace
 
-  transferred_label.resize(
-      *std::max_element(label_set.begin(), label_set.end()) + 1, -1);
+bool ParseVertexOrder(const std::string &name, VertexOrder *order) {
+  if (name == "none") {
+    *order = VertexOrder::kOriginal;
+  } else if (name == "degree") {
+    *order = VertexOrder::kDegree;
+  } else if (name == "bfs") {
+    *order = VertexOrder::kBfs;
+  } else {
+    return false;
+  }
+  return true;
+}
 
-  Label new_label = 0;
-  for (Label l : label_set) {
-    transferred_label[l] = new_label;
-    new_label += 1;
+Graph::Graph(const std::string &filename, size_t edge_index_threshold)
+    : edge_index_threshold_(edge_index_threshold) {
+  if (IsBinaryGraph(filename)) {
+    LoadBinary(filename);
+  } else {
+    LoadText(filename, nullptr);
   }
+  BuildEdgeIndex(edge_index_threshold_);
 }
-}  // namespace
 
-Graph::Graph(const std::string &filename, bool is_query) {
-  if (!is_query) {
-    TransferLabel(filename);
+Graph::Graph(const std::string &filename, const Graph &data) {
+  if (IsBinaryGraph(filename)) {
+    std::cout << "Binary graph file " << filename
+              << " can only be a data graph!\n";
+    exit(EXIT_FAILURE);
   }
-  std::vector<std::vector<Vertex>> adj_list;
+  LoadText(filename, &data);
+}
 
-  // Load Graph
-  std::ifstream fin(filename);
-  std::set<Label> label_set;
+void Graph::LoadText(const std::string &filename, const Graph *data) {
+  TextReader fin(filename);
 
-  if (!fin.is_open()) {
+  if (!fin.IsOpen()) {
     std::cout << "Graph file " << filename << " not found!\n";
     exit(EXIT_FAILURE);
   }
 
   char type;
 
-  fin >> type >> graph_id_ >> num_vertices_;
-
-  adj_list.resize(num_vertices_);
+  fin.ReadChar(type);
+  fin.ReadInt(graph_id_);
+  fin.ReadInt(num_vertices_);
 
-  start_offset_.resize(num_vertices_ + 1);
-  label_.resize(num_vertices_);
+  start_offset_storage_.assign(num_vertices_ + 1, 0);
+  label_storage_.resize(num_vertices_);
+  start_offset_ = start_offset_storage_.data();
+  label_ = label_storage_.data();
 
-  num_edges_ = 0;
+  // edge endpoints in file order, turned into CSR by a counting sort below.
+  // An edge line takes at least 8 bytes, so this never grows; the pages
+  // reserved beyond the edges are never touched
+  std::vector<Vertex> edges;
+  edges.reserve(fin.GetSize() / 4);
 
-  // preprocessing
-  while (fin >> type) {
+  // single pass over the file
+  while (fin.ReadChar(type)) {
     if (type == 'v') {
       Vertex id;
       Label l;
-      fin >> id >> l;
+      fin.ReadInt(id);
+      fin.ReadInt(l);
 
-      if (static_cast<size_t>(l) >= transferred_label.size())
-        l = -1;
-      else
-        l = transferred_label[l];
-
-      label_[id] = l;
-      label_set.insert(l);
+      label_storage_[id] = l;
     } else if (type == 'e') {
       Vertex v1, v2;
       Label l;
-      fin >> v1 >> v2 >> l;
+      fin.ReadInt(v1);
+      fin.ReadInt(v2);
+      fin.ReadInt(l);
 
-      adj_list[v1].push_back(v2);
-      adj_list[v2].push_back(v1);
+      edges.push_back(v1);
+      edges.push_back(v2);
+    }
+  }
 
-      num_edges_ += 1;
+  // a query graph is relabeled with the table of its data graph
+  if (data == nullptr) {
+    transferred_label_storage_ = TransferLabel(label_storage_);
+    transferred_label_ = transferred_label_storage_.data();
+    num_transferred_labels_ = transferred_label_storage_.size();
+  } else {
+    transferred_label_ = data->transferred_label_;
+    num_transferred_labels_ = data->num_transferred_labels_;
+  }
+
+  // relabel, and collect the label set as a bitmap shifted by one so that the
+  // -1 of a query label missing from the data graph has a slot too
+  std::vector<bool> label_set;
+  num_labels_ = 0;
+  max_label_ = -1;
+  for (size_t i = 0; i < num_vertices_; ++i) {
+    Label l = label_storage_[i];
+    if (l < 0 || static_cast<size_t>(l) >= num_transferred_labels_)
+      l = -1;
+    else
+      l = transferred_label_[l];
+    label_storage_[i] = l;
+
+    if (static_cast<size_t>(l + 1) >= label_set.size())
+      label_set.resize(l + 2, false);
+    if (!label_set[l + 1]) {
+      label_set[l + 1] = true;
+      num_labels_ += 1;
     }
+    max_label_ = std::max(max_label_, l);
   }
 
-  fin.close();
+  num_edges_ = edges.size() / 2;
 
-  adj_array_.resize(num_edges_ * 2);
+  // counting sort of the edge endpoints into adj_array_
+  for (Vertex v : edges) start_offset_storage_[v + 1] += 1;
+  for (size_t i = 0; i < num_vertices_; ++i)
+    start_offset_storage_[i + 1] += start_offset_storage_[i];
 
-  num_labels_ = label_set.size();
+  adj_array_storage_.resize(num_edges_ * 2);
+  adj_array_ = adj_array_storage_.data();
 
-  max_label_ = *std::max_element(label_set.begin(), label_set.end());
+  std::vector<size_t> cursor(start_offset_storage_.begin(),
+                             start_offset_storage_.end() - 1);
+  for (size_t i = 0; i < edges.size(); i += 2) {
+    adj_array_storage_[cursor[edges[i]]++] = edges[i + 1];
+    adj_array_storage_[cursor[edges[i + 1]]++] = edges[i];
+  }
 
-  label_frequency_.resize(max_label_ + 1);
+  label_frequency_storage_.assign(max_label_ + 1, 0);
+  label_frequency_ = label_frequency_storage_.data();
+
+  for (size_t i = 0; i < num_vertices_; ++i) {
+    if (GetLabel(i) >= 0) label_frequency_storage_[GetLabel(i)] += 1;
+
+    // sort neighbors by ascending order of label first, and ascending order of
+    // id second
+    std::sort(adj_array_storage_.begin() + start_offset_[i],
+              adj_array_storage_.begin() + start_offset_[i + 1],
+              [this](Vertex u, Vertex v) {
+                if (GetLabel(u) != GetLabel(v))
+                  return GetLabel(u) < GetLabel(v);
+                else
+                  return u < v;
+              });
+  }
 
-  start_offset_by_label_.resize(num_vertices_ * (max_label_ + 1));
+  BuildLabelIndex();
+}
 
-  start_offset_[0] = 0;
-  for (size_t i = 0; i < adj_list.size(); ++i) {
-    start_offset_[i + 1] = start_offset_[i] + adj_list[i].size();
+void Graph::BuildLabelIndex() {
+  // a label segment per label present; labels missing from the data graph get
+  // none
+  label_segment_offset_storage_.assign(num_vertices_ + 1, 0);
+  for (size_t i = 0; i < num_vertices_; ++i) {
+    size_t count = 0;
+    for (size_t j = start_offset_[i]; j < start_offset_[i + 1]; ++j) {
+      Label l = GetLabel(adj_array_[j]);
+      if (l >= 0 && (j == start_offset_[i] || GetLabel(adj_array_[j - 1]) != l))
+        count += 1;
+    }
+    label_segment_offset_storage_[i + 1] =
+        label_segment_offset_storage_[i] + count;
+  }
+  num_label_segments_ = label_segment_offset_storage_[num_vertices_];
+
+  // the dense table answers with two loads and no search, but grows with the
+  // number of labels
+  dense_label_index_ = static_cast<size_t>(max_label_ + 1) <= kMaxDenseLabels;
+
+  if (dense_label_index_) {
+    label_segment_offset_storage_.clear();
+    label_segment_offset_storage_.shrink_to_fit();
+    label_prefix_storage_.assign(num_vertices_ * (max_label_ + 2), 0);
+
+    for (size_t i = 0; i < num_vertices_; ++i) {
+      uint32_t* prefix = label_prefix_storage_.data() + i * (max_label_ + 2);
+      // prefix[l] counts the neighbors with a label below l, -1 included
+      uint32_t degree = GetDegree(i);
+      uint32_t j = 0;
+      for (Label l = 0; l <= max_label_ + 1; ++l) {
+        while (j < degree && GetLabel(adj_array_[start_offset_[i] + j]) < l)
+          ++j;
+        prefix[l] = j;
+      }
+    }
+  } else {
+    label_segment_storage_.resize(num_label_segments_);
+
+    for (size_t i = 0; i < num_vertices_; ++i) {
+      LabelSegment* segment =
+          label_segment_storage_.data() + label_segment_offset_storage_[i];
+      for (size_t j = start_offset_[i]; j < start_offset_[i + 1]; ++j) {
+        Label l = GetLabel(adj_array_[j]);
+        if (l >= 0 &&
+            (j == start_offset_[i] || GetLabel(adj_array_[j - 1]) != l)) {
+          segment->label = l;
+          segment->begin = j - start_offset_[i];
+          ++segment;
+        }
+      }
+    }
   }
 
-  for (size_t i = 0; i < adj_list.size(); ++i) {
-    label_frequency_[GetLabel(i)] += 1;
+  label_prefix_ = label_prefix_storage_.data();
+  label_segment_offset_ = label_segment_offset_storage_.data();
+  label_segment_ = label_segment_storage_.data();
+}
 
-    auto &neighbors = adj_list[i];
+void Graph::LoadBinary(const std::string &filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    std::cout << "Graph file " << filename << " not found!\n";
+    exit(EXIT_FAILURE);
+  }
 
-    if (neighbors.size() == 0) continue;
+  mapped_size_ = st.st_size;
+  mapped_ = mmap(nullptr, mapped_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped_ == MAP_FAILED || mapped_size_ < sizeof(BinaryHeader)) {
+    std::cout << "Graph file " << filename << " cannot be mapped!\n";
+    exit(EXIT_FAILURE);
+  }
 
-    // sort neighbors by ascending order of label first, and descending order of
-    // degree second
-    std::sort(neighbors.begin(), neighbors.end(), [this](Vertex u, Vertex v) {
-      if (GetLabel(u) != GetLabel(v))
-        return GetLabel(u) < GetLabel(v);
-      else if (GetDegree(u) != GetDegree(v))
-        return GetDegree(u) > GetDegree(v);
-      else
-        return u < v;
-    });
+  const char *base = static_cast<const char *>(mapped_);
+  const BinaryHeader *header = reinterpret_cast<const BinaryHeader *>(base);
+  if (memcmp(header->magic, kBinaryMagic, sizeof(kBinaryMagic)) != 0) {
+    std::cout << "Graph file " << filename
+              << " has an outdated binary format, convert it again!\n";
+    exit(EXIT_FAILURE);
+  }
 
-    Vertex v = neighbors[0];
-    Label l = GetLabel(v);
+  graph_id_ = header->graph_id;
+  max_label_ = header->max_label;
+  num_vertices_ = header->num_vertices;
+  num_edges_ = header->num_edges;
+  num_labels_ = header->num_labels;
+  fingerprint_ = header->fingerprint;
+  has_fingerprint_ = true;
+  dense_label_index_ = header->dense_label_index != 0;
+  num_label_segments_ = header->num_label_segments;
+  num_transferred_labels_ = header->num_transferred_labels;
+
+  // the counts of the header place every section, so all of them are laid
+  // out and checked against the file before any of them is read
+  bool fits = max_label_ >= -1 &&
+              dense_label_index_ ==
+                  (static_cast<size_t>(max_label_ + 1) <= kMaxDenseLabels) &&
+              num_vertices_ < UINT32_MAX && num_edges_ < SIZE_MAX / 2;
+  size_t offset = sizeof(BinaryHeader);
+  auto section = [&](size_t count, size_t size) {
+    offset = AlignUp(offset);
+    if (!fits || offset > mapped_size_ ||
+        count > (mapped_size_ - offset) / size) {
+      fits = false;
+      return base;
+    }
+    const char *begin = base + offset;
+    offset += count * size;
+    return begin;
+  };
+
+  label_frequency_ = reinterpret_cast<const size_t *>(
+      section(max_label_ + 1, sizeof(size_t)));
+  start_offset_ = reinterpret_cast<const size_t *>(
+      section(num_vertices_ + 1, sizeof(size_t)));
+  label_prefix_ = nullptr;
+  label_segment_offset_ = nullptr;
+  label_segment_ = nullptr;
+  if (dense_label_index_) {
+    label_prefix_ = reinterpret_cast<const uint32_t *>(
+        section(num_vertices_ * (max_label_ + 2), sizeof(uint32_t)));
+  } else {
+    label_segment_offset_ = reinterpret_cast<const size_t *>(
+        section(num_vertices_ + 1, sizeof(size_t)));
+    label_segment_ = reinterpret_cast<const LabelSegment *>(
+        section(num_label_segments_, sizeof(LabelSegment)));
+  }
+  label_ = reinterpret_cast<const Label *>(
+      section(num_vertices_, sizeof(Label)));
+  adj_array_ = reinterpret_cast<const Vertex *>(
+      section(num_edges_ * 2, sizeof(Vertex)));
+  transferred_label_ = reinterpret_cast<const Label *>(
+      section(num_transferred_labels_, sizeof(Label)));
+  original_id_ = nullptr;
+  if (header->reordered) {
+    original_id_ = reinterpret_cast<const Vertex *>(
+        section(num_vertices_, sizeof(Vertex)));
+  }
 
-    start_offset_by_label_[i * (max_label_ + 1) + l].first = start_offset_[i];
+  if (!fits) {
+    std::cout << "Graph file " << filename << " cannot be mapped!\n";
+    exit(EXIT_FAILURE);
+  }
 
-    for (size_t j = 1; j < neighbors.size(); ++j) {
-      v = neighbors[j];
-      Label next_l = GetLabel(v);
+  if (original_id_ != nullptr) {
+    internal_id_.resize(num_vertices_);
+    for (size_t v = 0; v < num_vertices_; ++v) {
+      if (static_cast<size_t>(original_id_[v]) >= num_vertices_) {
+        std::cout << "Graph file " << filename << " cannot be mapped!\n";
+        exit(EXIT_FAILURE);
+      }
+      internal_id_[original_id_[v]] = v;
+    }
+  }
+}
 
-      if (l != next_l) {
-        start_offset_by_label_[i * (max_label_ + 1) + l].second =
-            start_offset_[i] + j;
-        start_offset_by_label_[i * (max_label_ + 1) + next_l].first =
-            start_offset_[i] + j;
-        l = next_l;
+/**
+ * @brief Renumbers the vertices in the given order, so that the vertices the
+ * search looks at together sit close in memory. Candidate sets read from a
+ * file have to be translated with GetInternalId(), and matches back with
+ * GetOriginalId(). Only meaningful for a data graph.
+ *
+ * @param order
+ */
+void Graph::Reorder(VertexOrder order) {
+  if (order == VertexOrder::kOriginal) return;
+
+  // vertex of every new id, by label first whatever the order
+  std::vector<Vertex> by_rank(num_vertices_);
+  if (order == VertexOrder::kDegree) {
+    for (size_t v = 0; v < num_vertices_; ++v) by_rank[v] = v;
+    std::stable_sort(by_rank.begin(), by_rank.end(), [this](Vertex u, Vertex v) {
+      return GetDegree(u) > GetDegree(v);
+    });
+  } else {
+    // Cuthill-McKee from a vertex of least degree in every component, the
+    // neighbors of a vertex visited by ascending degree, then reversed
+    std::vector<Vertex> starts(num_vertices_);
+    for (size_t v = 0; v < num_vertices_; ++v) starts[v] = v;
+    std::stable_sort(starts.begin(), starts.end(), [this](Vertex u, Vertex v) {
+      return GetDegree(u) < GetDegree(v);
+    });
+    std::vector<bool> visited(num_vertices_, false);
+    size_t size = 0;
+    for (Vertex s : starts) {
+      if (visited[s]) continue;
+      visited[s] = true;
+      by_rank[size++] = s;
+      for (size_t head = size - 1; head < size; ++head) {
+        Vertex u = by_rank[head];
+        size_t first = size;
+        for (size_t i = GetNeighborStartOffset(u); i < GetNeighborEndOffset(u);
+             ++i) {
+          Vertex w = GetNeighbor(i);
+          if (visited[w]) continue;
+          visited[w] = true;
+          by_rank[size++] = w;
+        }
+        std::stable_sort(by_rank.begin() + first, by_rank.begin() + size,
+                         [this](Vertex a, Vertex b) {
+                           return GetDegree(a) < GetDegree(b);
+                         });
       }
     }
+    std::reverse(by_rank.begin(), by_rank.end());
+  }
+  std::stable_sort(by_rank.begin(), by_rank.end(), [this](Vertex u, Vertex v) {
+    return GetLabel(u) < GetLabel(v);
+  });
+
+  std::vector<Vertex> new_id(num_vertices_);
+  for (size_t r = 0; r < num_vertices_; ++r) new_id[by_rank[r]] = r;
+
+  std::vector<size_t> start_offset(num_vertices_ + 1, 0);
+  std::vector<Label> label(num_vertices_);
+  std::vector<Vertex> adj_array(num_edges_ * 2);
+  std::vector<Vertex> original_id(num_vertices_);
+  for (size_t r = 0; r < num_vertices_; ++r) {
+    Vertex v = by_rank[r];
+    label[r] = GetLabel(v);
+    original_id[r] = GetOriginalId(v);
+    size_t begin = start_offset[r];
+    start_offset[r + 1] = begin + GetDegree(v);
+    for (size_t i = GetNeighborStartOffset(v); i < GetNeighborEndOffset(v); ++i)
+      adj_array[begin + i - GetNeighborStartOffset(v)] = new_id[GetNeighbor(i)];
+    // the new ids are grouped by label, so id order is (label, id) order
+    std::sort(adj_array.begin() + begin, adj_array.begin() + start_offset[r + 1]);
+  }
+
+  // whatever still points into a mapped file is copied out first
+  if (mapped_ != nullptr) {
+    label_frequency_storage_.assign(label_frequency_,
+                                    label_frequency_ + max_label_ + 1);
+    transferred_label_storage_.assign(
+        transferred_label_, transferred_label_ + num_transferred_labels_);
+    label_frequency_ = label_frequency_storage_.data();
+    transferred_label_ = transferred_label_storage_.data();
+    munmap(mapped_, mapped_size_);
+    mapped_ = nullptr;
+  }
+
+  start_offset_storage_.swap(start_offset);
+  label_storage_.swap(label);
+  adj_array_storage_.swap(adj_array);
+  original_id_storage_.swap(original_id);
+  start_offset_ = start_offset_storage_.data();
+  label_ = label_storage_.data();
+  adj_array_ = adj_array_storage_.data();
+  original_id_ = original_id_storage_.data();
+  internal_id_.resize(num_vertices_);
+  for (size_t v = 0; v < num_vertices_; ++v) internal_id_[original_id_[v]] = v;
+
+  BuildLabelIndex();
+  BuildEdgeIndex(edge_index_threshold_);
+  has_fingerprint_ = false;
+}
+
+void Graph::ComputeFingerprint() const {
+  // the neighbors of a vertex are sorted by label and id in every format
+  uint64_t hash = HashCombine(num_vertices_, num_edges_);
+  for (size_t v = 0; v < num_vertices_; ++v) {
+    hash = HashCombine(hash, static_cast<uint64_t>(GetLabel(v)) << 32 |
+                                 GetDegree(v));
+    for (size_t i = GetNeighborStartOffset(v); i < GetNeighborEndOffset(v); ++i)
+      hash = HashCombine(hash, GetNeighbor(i));
+  }
+  fingerprint_ = hash;
+  has_fingerprint_ = true;
+}
+
+void Graph::BuildEdgeIndex(size_t degree_threshold) {
+  // a bitmap must not be more than 64 bits per neighbor
+  degree_threshold = std::max(degree_threshold, (num_vertices_ + 63) / 64);
+  num_indexed_vertices_ = 0;
+  num_bitmap_words_ = 0;
+  edge_bitmap_slot_.clear();
+  edge_bitmap_.clear();
+  for (size_t v = 0; v < num_vertices_; ++v) {
+    if (GetDegree(v) >= degree_threshold) num_indexed_vertices_ += 1;
+  }
+  if (num_indexed_vertices_ == 0) return;
+
+  num_bitmap_words_ = (num_vertices_ + 63) / 64;
+  edge_bitmap_slot_.assign(num_vertices_, UINT32_MAX);
+  edge_bitmap_.assign(num_indexed_vertices_ * num_bitmap_words_, 0);
+
+  uint32_t slot = 0;
+  for (size_t v = 0; v < num_vertices_; ++v) {
+    if (GetDegree(v) < degree_threshold) continue;
+    uint64_t *bitmap = edge_bitmap_.data() + slot * num_bitmap_words_;
+    for (size_t i = GetNeighborStartOffset(v); i < GetNeighborEndOffset(v);
+         ++i) {
+      Vertex w = GetNeighbor(i);
+      bitmap[w >> 6] |= uint64_t(1) << (w & 63);
+    }
+    edge_bitmap_slot_[v] = slot++;
+  }
+}
+
+/**
+ * @brief Writes the graph in the binary CSR format, which the constructor
+ * maps into memory without parsing. Only meaningful for a data graph, whose
+ * label remap table is stored with it.
+ *
+ * @param filename
+ */
+void Graph::Save(const std::string &filename) const {
+  std::ofstream fout(filename, std::ios::binary);
 
-    start_offset_by_label_[i * (max_label_ + 1) + l].second =
-        start_offset_[i + 1];
+  if (!fout.is_open()) {
+    std::cout << "Graph file " << filename << " cannot be written!\n";
+    exit(EXIT_FAILURE);
+  }
 
-    std::copy(adj_list[i].begin(), adj_list[i].end(),
-              adj_array_.begin() + start_offset_[i]);
+  BinaryHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kBinaryMagic, sizeof(kBinaryMagic));
+  header.graph_id = graph_id_;
+  header.max_label = max_label_;
+  header.num_vertices = num_vertices_;
+  header.num_edges = num_edges_;
+  header.num_labels = num_labels_;
+  header.num_transferred_labels = num_transferred_labels_;
+  header.num_label_segments = num_label_segments_;
+  header.dense_label_index = dense_label_index_;
+  header.reordered = IsReordered();
+  header.fingerprint = GetFingerprint();
+
+  size_t written = 0;
+  auto write_section = [&fout, &written](const void *data, size_t size) {
+    static const char padding[8] = {0};
+    fout.write(padding, AlignUp(written) - written);
+    written = AlignUp(written);
+    fout.write(static_cast<const char *>(data), size);
+    written += size;
+  };
+
+  write_section(&header, sizeof(header));
+  write_section(label_frequency_, sizeof(size_t) * (max_label_ + 1));
+  write_section(start_offset_, sizeof(size_t) * (num_vertices_ + 1));
+  if (dense_label_index_) {
+    write_section(label_prefix_,
+                  sizeof(uint32_t) * num_vertices_ * (max_label_ + 2));
+  } else {
+    write_section(label_segment_offset_, sizeof(size_t) * (num_vertices_ + 1));
+    write_section(label_segment_, sizeof(LabelSegment) * num_label_segments_);
+  }
+  write_section(label_, sizeof(Label) * num_vertices_);
+  write_section(adj_array_, sizeof(Vertex) * num_edges_ * 2);
+  write_section(transferred_label_, sizeof(Label) * num_transferred_labels_);
+  if (IsReordered())
+    write_section(original_id_, sizeof(Vertex) * num_vertices_);
+
+  if (!fout) {
+    std::cout << "Graph file " << filename << " cannot be written!\n";
+    exit(EXIT_FAILURE);
   }
 }
 
-Graph::~Graph() {}
+Graph::~Graph() {
+  if (mapped_ != nullptr) munmap(mapped_, mapped_size_);
+}
@@ -0,0 +1,197 @@
+/**
+ * @file intersection.cc
+ *
+ */
+
+#include "intersection.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define INTERSECTION_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+// merge for balanced sizes, galloping from the smaller array otherwise
+size_t IntersectScalar(const uint32_t* a, size_t na, const uint32_t* b,
+                       size_t nb, uint32_t* out) {
+  if (na > nb) {
+    std::swap(a, b);
+    std::swap(na, nb);
+  }
+  size_t count = 0;
+
+  if (na * 32 < nb) {
+    size_t lo = 0;
+    for (size_t i = 0; i < na && lo < nb; ++i) {
+      // double the step until b[hi] >= a[i], then binary search [lo, hi]
+      size_t step = 1;
+      size_t hi = lo;
+      while (hi < nb && b[hi] < a[i]) {
+        lo = hi + 1;
+        hi = lo + step;
+        step <<= 1;
+      }
+      lo = std::lower_bound(b + lo, b + std::min(hi, nb), a[i]) - b;
+      if (lo < nb && b[lo] == a[i]) out[count++] = a[i];
+    }
+    return count;
+  }
+
+  size_t i = 0, j = 0;
+  while (i < na && j < nb) {
+    if (a[i] < b[j]) {
+      ++i;
+    } else if (a[i] > b[j]) {
+      ++j;
+    } else {
+      out[count++] = a[i];
+      ++i;
+      ++j;
+    }
+  }
+  return count;
+}
+
+#ifdef INTERSECTION_X86
+// kShuffleSSE[mask] moves the 32-bit lanes selected by mask to the front
+alignas(16) uint8_t kShuffleSSE[16][16];
+// kShuffleAVX2[mask] does the same for 8 lanes with permutevar8x32
+alignas(32) uint32_t kShuffleAVX2[256][8];
+
+bool BuildShuffleTables() {
+  for (int mask = 0; mask < 16; ++mask) {
+    int k = 0;
+    for (int lane = 0; lane < 4; ++lane) {
+      if (!(mask & (1 << lane))) continue;
+      for (int byte = 0; byte < 4; ++byte)
+        kShuffleSSE[mask][k * 4 + byte] = lane * 4 + byte;
+      ++k;
+    }
+    for (; k < 4; ++k)
+      for (int byte = 0; byte < 4; ++byte) kShuffleSSE[mask][k * 4 + byte] = 0;
+  }
+  for (int mask = 0; mask < 256; ++mask) {
+    int k = 0;
+    for (int lane = 0; lane < 8; ++lane)
+      if (mask & (1 << lane)) kShuffleAVX2[mask][k++] = lane;
+    for (; k < 8; ++k) kShuffleAVX2[mask][k] = 0;
+  }
+  return true;
+}
+const bool kShuffleTablesBuilt = BuildShuffleTables();
+
+// block-wise all-pairs comparison, 4x4 lanes per step
+__attribute__((target("sse4.2,popcnt"))) size_t IntersectSSE(
+    const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out) {
+  size_t i = 0, j = 0, count = 0;
+  size_t na4 = na & ~size_t(3), nb4 = nb & ~size_t(3);
+
+  while (i < na4 && j < nb4) {
+    __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+
+    __m128i vb1 = _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1));
+    __m128i vb2 = _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2));
+    __m128i vb3 = _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3));
+    __m128i cmp = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi32(va, vb), _mm_cmpeq_epi32(va, vb1)),
+        _mm_or_si128(_mm_cmpeq_epi32(va, vb2), _mm_cmpeq_epi32(va, vb3)));
+    int mask = _mm_movemask_ps(_mm_castsi128_ps(cmp));
+
+    __m128i shuffle =
+        _mm_load_si128(reinterpret_cast<const __m128i*>(kShuffleSSE[mask]));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + count),
+                     _mm_shuffle_epi8(va, shuffle));
+    count += _mm_popcnt_u32(mask);
+
+    uint32_t a_max = a[i + 3];
+    uint32_t b_max = b[j + 3];
+    if (a_max <= b_max) i += 4;
+    if (b_max <= a_max) j += 4;
+  }
+
+  return count + IntersectScalar(a + i, na - i, b + j, nb - j, out + count);
+}
+
+// block-wise all-pairs comparison, 8x8 lanes per step
+__attribute__((target("avx2,popcnt"))) size_t IntersectAVX2(
+    const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out) {
+  size_t i = 0, j = 0, count = 0;
+  size_t na8 = na & ~size_t(7), nb8 = nb & ~size_t(7);
+
+  const __m256i rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+
+  while (i < na8 && j < nb8) {
+    __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+    __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + j));
+
+    __m256i cmp = _mm256_cmpeq_epi32(va, vb);
+    for (int r = 1; r < 8; ++r) {
+      vb = _mm256_permutevar8x32_epi32(vb, rotate);
+      cmp = _mm256_or_si256(cmp, _mm256_cmpeq_epi32(va, vb));
+    }
+    int mask = _mm256_movemask_ps(_mm256_castsi256_ps(cmp));
+
+    __m256i shuffle = _mm256_load_si256(
+        reinterpret_cast<const __m256i*>(kShuffleAVX2[mask]));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + count),
+                        _mm256_permutevar8x32_epi32(va, shuffle));
+    count += _mm_popcnt_u32(mask);
+
+    uint32_t a_max = a[i + 7];
+    uint32_t b_max = b[j + 7];
+    if (a_max <= b_max) i += 8;
+    if (b_max <= a_max) j += 8;
+  }
+
+  return count + IntersectScalar(a + i, na - i, b + j, nb - j, out + count);
+}
+#endif
+
+IntersectionKernel DetectKernel() {
+#ifdef INTERSECTION_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+    return IntersectionKernel::kAVX2;
+  if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt"))
+    return IntersectionKernel::kSSE;
+#endif
+  return IntersectionKernel::kScalar;
+}
+
+const IntersectionKernel kSupportedKernel = DetectKernel();
+IntersectionKernel kernel_in_use = kSupportedKernel;
+}  // namespace
+
+size_t Intersect(const uint32_t* a, size_t na, const uint32_t* b, size_t nb,
+                 uint32_t* out) {
+#ifdef INTERSECTION_X86
+  // the block kernels only pay off when both sides span several blocks
+  size_t small = std::min(na, nb);
+  size_t large = std::max(na, nb);
+  if (small >= 8 && small * 32 >= large) {
+    if (kernel_in_use == IntersectionKernel::kAVX2)
+      return IntersectAVX2(a, na, b, nb, out);
+    if (kernel_in_use == IntersectionKernel::kSSE)
+      return IntersectSSE(a, na, b, nb, out);
+  }
+#endif
+  return IntersectScalar(a, na, b, nb, out);
+}
+
+IntersectionKernel GetIntersectionKernel() { return kernel_in_use; }
+
+void SetIntersectionKernel(IntersectionKernel kernel) {
+  kernel_in_use = std::min(kernel, kSupportedKernel);
+}
+
+const char* GetIntersectionKernelName(IntersectionKernel kernel) {
+  switch (kernel) {
+    case IntersectionKernel::kAVX2:
+      return "avx2";
+    case IntersectionKernel::kSSE:
+      return "sse4.2";
+    default:
+      return "scalar";
+  }
+}
@@ -0,0 +1,41 @@
+/**
+ * @file match_iterator.cc
+ *
+ */
+
+#include "match_iterator.h"
+
+/**
+ * @brief Plans the query; the search starts with the first Next().
+ *
+ * @param data data graph.
+ * @param query query graph.
+ * @param cs candidate set of query in data.
+ * @param options its leaf_decomposition, symmetry_breaking and plan_cache are
+ * not used.
+ */
+MatchIterator::MatchIterator(const Graph& data, const Graph& query,
+                             const CandidateSet& cs,
+                             const MatchOptions& options)
+    : cs_(cs), num_vertices_(query.GetNumVertices()), backtrack_(1) {
+  backtrack_.beginIteration(data, query, cs, dag_, space_, options);
+}
+
+MatchIterator::~MatchIterator() { backtrack_.endIteration(dag_); }
+
+/**
+ * @brief Searches for the next embedding.
+ *
+ * @return const Vertex* the data vertex of every query vertex, in query
+ * vertex id order and the ids of the data graph file, valid until the next
+ * call; null once there is none left or the search was stopped.
+ */
+const Vertex* MatchIterator::Next() {
+  if (done_) return nullptr;
+  const Vertex* embedding = backtrack_.nextMatch(cs_, dag_, space_);
+  if (embedding == nullptr)
+    done_ = true;
+  else
+    ++num_matches_;
+  return embedding;
+}
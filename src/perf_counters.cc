@@ -0,0 +1,117 @@
+/**
+ * @file perf_counters.cc
+ *
+ */
+
+#include "perf_counters.h"
+
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+struct Event {
+  const char* name;
+  uint32_t type;
+  uint64_t config;
+};
+
+#ifdef __linux__
+const Event kEvents[] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"cache-references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+    {"cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"task-clock-ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+    {"page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+};
+
+int OpenEvent(const Event& event) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = event.type;
+  attr.config = event.config;
+  attr.disabled = 1;
+  attr.inherit = 1;  // the workers are started after the counters
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+#else
+const Event kEvents[] = {
+    {"cycles", 0, 0},        {"instructions", 0, 0},
+    {"cache-references", 0, 0}, {"cache-misses", 0, 0},
+    {"branch-misses", 0, 0}, {"task-clock-ns", 0, 0},
+    {"page-faults", 0, 0},
+};
+#endif
+
+constexpr size_t kNumEvents = sizeof(kEvents) / sizeof(kEvents[0]);
+}  // namespace
+
+PerfCounters::PerfCounters() : fds_(kNumEvents, -1) {
+#ifdef __linux__
+  for (size_t i = 0; i < kNumEvents; ++i) fds_[i] = OpenEvent(kEvents[i]);
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+  for (int fd : fds_)
+    if (fd >= 0) close(fd);
+#endif
+}
+
+/**
+ * @brief Resets the counters and starts counting.
+ *
+ */
+void PerfCounters::Start() {
+#ifdef __linux__
+  for (int fd : fds_) {
+    if (fd < 0) continue;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+#endif
+}
+
+/**
+ * @brief Stops counting; the values are kept until the next Start().
+ *
+ */
+void PerfCounters::Stop() {
+#ifdef __linux__
+  for (int fd : fds_)
+    if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+}
+
+size_t PerfCounters::GetNumEvents() const { return kNumEvents; }
+
+const char* PerfCounters::GetEventName(size_t i) const {
+  return kEvents[i].name;
+}
+
+/**
+ * @brief Returns the count of the i-th event between Start() and Stop(), or
+ * -1 if the event is not available.
+ *
+ * @param i
+ * @return int64_t
+ */
+int64_t PerfCounters::GetValue(size_t i) const {
+#ifdef __linux__
+  uint64_t value;
+  if (fds_[i] >= 0 && read(fds_[i], &value, sizeof(value)) == sizeof(value))
+    return static_cast<int64_t>(value);
+#endif
+  return -1;
+}
@@ -0,0 +1,200 @@
+/**
+ * @file plan_cache.cc
+ *
+ */
+
+#include "plan_cache.h"
+
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+// a plan file written by another version of the signature, root and symmetry
+// constraints layout is a miss, and the plan is made and stored again
+const char kPlanMagic[8] = {'G', 'P', 'M', 'P', 'L', 'A', 'N', '1'};
+
+// the data graph, the options that change the plan, then every query vertex
+// with its label, degree and neighbors, which are sorted in every graph
+std::vector<int32_t> GetSignature(const Graph& data, const Graph& query,
+                                  const MatchOptions& options) {
+  std::vector<int32_t> signature;
+  signature.reserve(4 + 2 * query.GetNumVertices() + 2 * query.GetNumEdges());
+  uint64_t fingerprint = data.GetFingerprint();
+  signature.push_back(static_cast<int32_t>(fingerprint));
+  signature.push_back(static_cast<int32_t>(fingerprint >> 32));
+  signature.push_back(options.leaf_decomposition |
+                      options.symmetry_breaking << 1);
+  signature.push_back(query.GetNumVertices());
+  for (size_t u = 0; u < query.GetNumVertices(); ++u) {
+    signature.push_back(query.GetLabel(u));
+    signature.push_back(query.GetDegree(u));
+    for (size_t i = query.GetNeighborStartOffset(u);
+         i < query.GetNeighborEndOffset(u); ++i)
+      signature.push_back(query.GetNeighbor(i));
+  }
+  return signature;
+}
+
+uint64_t Hash(const std::vector<int32_t>& signature) {
+  uint64_t hash = signature.size();
+  for (int32_t word : signature) hash = HashCombine(hash, word);
+  return hash;
+}
+}  // namespace
+
+/**
+ * @brief Keeps up to capacity plans in memory, and in directory as well if
+ * it is not empty; the directory is created if needed.
+ *
+ * @param capacity at least 1.
+ * @param directory
+ */
+PlanCache::PlanCache(size_t capacity, const std::string& directory)
+    : capacity_(std::max<size_t>(capacity, 1)), directory_(directory) {
+  if (!directory_.empty()) mkdir(directory_.c_str(), 0755);
+}
+
+/**
+ * @brief Returns the plan of query against data, from memory or from the
+ * directory, or a new one without a root that the caller makes and then
+ * hands to Store(). The plan stays valid until the next Find().
+ *
+ * @param data data graph.
+ * @param query query graph, its labels those of data.
+ * @param options only the flags that change the plan are part of the key.
+ * @return QueryPlan&
+ */
+QueryPlan& PlanCache::Find(const Graph& data, const Graph& query,
+                           const MatchOptions& options) {
+  std::vector<int32_t> signature = GetSignature(data, query, options);
+  uint64_t key = Hash(signature);
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    if (it->second->signature == signature) {
+      plans_.splice(plans_.begin(), plans_, it->second);
+      ++stats_.hits;
+      return plans_.front();
+    }
+    // another query with the same hash, replaced
+    plans_.erase(it->second);
+    index_.erase(it);
+  }
+
+  plans_.emplace_front();
+  QueryPlan& plan = plans_.front();
+  plan.key = key;
+  plan.signature.swap(signature);
+  index_[key] = plans_.begin();
+  if (plans_.size() > capacity_) {
+    index_.erase(plans_.back().key);
+    plans_.pop_back();
+    ++stats_.evictions;
+  }
+  stats_.size = plans_.size();
+
+  if (Load(query, plan)) {
+    ++stats_.hits;
+    ++stats_.disk_loads;
+  } else {
+    ++stats_.misses;
+  }
+  return plan;
+}
+
+/**
+ * @brief Writes a plan just made to the directory, if there is one. Failing
+ * to write only costs the plan being made again by a later process.
+ *
+ * @param plan
+ */
+void PlanCache::Store(const QueryPlan& plan) {
+  if (directory_.empty() || plan.root < 0) return;
+  // written aside and renamed, so that a reader never sees half a plan
+  std::string file_name = GetFileName(plan.key);
+  std::string temporary_name = file_name + ".tmp";
+  {
+    std::ofstream fout(temporary_name, std::ios::binary);
+    if (!fout.is_open()) return;
+    uint64_t size = plan.signature.size();
+    fout.write(kPlanMagic, sizeof(kPlanMagic));
+    fout.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    fout.write(reinterpret_cast<const char*>(plan.signature.data()),
+               sizeof(int32_t) * size);
+    fout.write(reinterpret_cast<const char*>(&plan.root), sizeof(plan.root));
+    plan.symmetry.Save(fout);
+    if (!fout) {
+      fout.close();
+      std::remove(temporary_name.c_str());
+      return;
+    }
+  }
+  std::rename(temporary_name.c_str(), file_name.c_str());
+}
+
+/**
+ * @brief Returns the candidate space of plan for cs: the one of the last
+ * call if cs has the same candidates, otherwise a new one built in its
+ * place. plan.dag must be built.
+ *
+ * @param plan
+ * @param data data graph.
+ * @param query query graph of the plan.
+ * @param cs candidate set.
+ * @return const CandidateSpace&
+ */
+const CandidateSpace& PlanCache::GetSpace(QueryPlan& plan, const Graph& data,
+                                          const Graph& query,
+                                          const CandidateSet& cs) {
+  uint64_t fingerprint = cs.ComputeFingerprint();
+  if (plan.has_space && plan.candidate_fingerprint == fingerprint) {
+    ++stats_.space_hits;
+    return plan.space;
+  }
+  plan.space.Build(data, query, cs, plan.dag);
+  plan.has_space = true;
+  plan.candidate_fingerprint = fingerprint;
+  return plan.space;
+}
+
+/**
+ * @brief Drops every plan in memory; those in the directory stay.
+ *
+ */
+void PlanCache::Clear() {
+  plans_.clear();
+  index_.clear();
+  stats_.size = 0;
+}
+
+std::string PlanCache::GetFileName(uint64_t key) const {
+  char name[32];
+  snprintf(name, sizeof(name), "/%016llx.plan",
+           static_cast<unsigned long long>(key));
+  return directory_ + name;
+}
+
+bool PlanCache::Load(const Graph& query, QueryPlan& plan) {
+  if (directory_.empty()) return false;
+  std::ifstream fin(GetFileName(plan.key), std::ios::binary);
+  char magic[sizeof(kPlanMagic)];
+  uint64_t size;
+  if (!fin.read(magic, sizeof(magic)) ||
+      memcmp(magic, kPlanMagic, sizeof(magic)) != 0 ||
+      !fin.read(reinterpret_cast<char*>(&size), sizeof(size)) ||
+      size != plan.signature.size())
+    return false;
+  std::vector<int32_t> signature(size);
+  Vertex root;
+  if (!fin.read(reinterpret_cast<char*>(signature.data()),
+                sizeof(int32_t) * size) ||
+      signature != plan.signature ||
+      !fin.read(reinterpret_cast<char*>(&root), sizeof(root)) || root < 0 ||
+      static_cast<size_t>(root) >= query.GetNumVertices() ||
+      !plan.symmetry.Load(fin, query.GetNumVertices()))
+    return false;
+  plan.root = root;
+  plan.dag.Build(query, root);
+  return true;
+}
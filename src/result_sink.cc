@@ -0,0 +1,127 @@
+/**
+ * @file result_sink.cc
+ *
+ */
+
+#include "result_sink.h"
+
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+namespace {
+constexpr size_t kBufferSize = 1 << 20;
+
+void WriteAll(int fd, const char* data, size_t size) {
+  while (size > 0) {
+    ssize_t written = write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return;
+    }
+    data += written;
+    size -= written;
+  }
+}
+
+// writes the decimal digits of a non-negative value backwards from end
+inline char* FormatUnsigned(uint32_t value, char* end) {
+  do {
+    *--end = '0' + value % 10;
+    value /= 10;
+  } while (value != 0);
+  return end;
+}
+}  // namespace
+
+TextSink::TextSink(int fd) : fd_(fd), buffer_(kBufferSize) {}
+
+TextSink::~TextSink() { Flush(); }
+
+void TextSink::Begin(size_t num_query_vertices) {
+  row_size_ = num_query_vertices;
+  // whatever went through std::cout has to come first
+  std::cout.flush();
+
+  char digits[24];
+  char* end = digits + sizeof(digits);
+  char* begin = FormatUnsigned(num_query_vertices, end);
+  buffer_[size_++] = 't';
+  buffer_[size_++] = ' ';
+  memcpy(buffer_.data() + size_, begin, end - begin);
+  size_ += end - begin;
+}
+
+void TextSink::Consume(const Vertex* rows, size_t num_rows) {
+  // "\na " and at most 10 digits and a space per vertex
+  size_t max_line = 3 + 11 * row_size_;
+  for (size_t i = 0; i < num_rows; ++i) {
+    if (size_ + max_line > buffer_.size()) {
+      Flush();
+      if (max_line > buffer_.size()) buffer_.resize(max_line);
+    }
+    char* out = buffer_.data() + size_;
+    *out++ = '\n';
+    *out++ = 'a';
+    *out++ = ' ';
+    const Vertex* row = rows + i * row_size_;
+    for (size_t u = 0; u < row_size_; ++u) {
+      char digits[10];
+      char* end = digits + sizeof(digits);
+      char* begin = FormatUnsigned(row[u], end);
+      memcpy(out, begin, end - begin);
+      out += end - begin;
+      *out++ = ' ';
+    }
+    size_ = out - buffer_.data();
+  }
+}
+
+void TextSink::End(size_t num_matches) {
+  if (size_ == buffer_.size()) Flush();
+  buffer_[size_++] = '\n';
+  Flush();
+}
+
+void TextSink::Flush() {
+  WriteAll(fd_, buffer_.data(), size_);
+  size_ = 0;
+}
+
+BinarySink::BinarySink(int fd) : fd_(fd), buffer_(kBufferSize) {}
+
+BinarySink::~BinarySink() { Flush(); }
+
+void BinarySink::Begin(size_t num_query_vertices) {
+  row_size_ = num_query_vertices;
+  int32_t width = num_query_vertices;
+  Append(&width, sizeof(width));
+}
+
+void BinarySink::Consume(const Vertex* rows, size_t num_rows) {
+  Append(rows, sizeof(Vertex) * row_size_ * num_rows);
+}
+
+void BinarySink::End(size_t num_matches) {
+  int32_t terminator = -1;
+  Append(&terminator, sizeof(terminator));
+  Flush();
+}
+
+void BinarySink::Append(const void* data, size_t size) {
+  if (size_ + size > buffer_.size()) {
+    Flush();
+    // large batches skip the buffer
+    if (size > buffer_.size()) {
+      WriteAll(fd_, static_cast<const char*>(data), size);
+      return;
+    }
+  }
+  memcpy(buffer_.data() + size_, data, size);
+  size_ += size;
+}
+
+void BinarySink::Flush() {
+  WriteAll(fd_, buffer_.data(), size_);
+  size_ = 0;
+}
@@ -0,0 +1,176 @@
+/**
+ * @file search_profile.cc
+ *
+ */
+
+#include "search_profile.h"
+
+#ifdef SEARCH_PROFILE
+thread_local uint64_t num_is_neighbor_calls = 0;
+#endif
+
+namespace {
+void AddTo(std::vector<uint64_t>& to, const std::vector<uint64_t>& from) {
+  if (to.size() < from.size()) to.resize(from.size(), 0);
+  for (size_t i = 0; i < from.size(); ++i) to[i] += from[i];
+}
+
+void WriteArray(std::ostream& out, const std::vector<uint64_t>& values) {
+  out << "[";
+  for (size_t i = 0; i < values.size(); ++i)
+    out << (i == 0 ? "" : ", ") << values[i];
+  out << "]";
+}
+}  // namespace
+
+/**
+ * @brief Zeroes the counters and drops the samples, for a query of
+ * num_query_vertices vertices.
+ *
+ * @param num_query_vertices
+ */
+void SearchProfile::Clear(size_t num_query_vertices) {
+  num_candidates.assign(num_query_vertices, 0);
+  is_leaf.assign(num_query_vertices, 0);
+  root = -1;
+  nodes_per_depth.assign(num_query_vertices, 0);
+  nodes_per_vertex.assign(num_query_vertices, 0);
+  backtracks.assign(num_query_vertices, 0);
+  backjumps.assign(num_query_vertices, 0);
+  rejected_visited = rejected_order = rejected_leaves = 0;
+  extendable_copies = extendable_intersections = 0;
+  rejected_edges = empty_extendable = is_neighbor_calls = 0;
+  samples.clear();
+  dropped_samples = 0;
+  sample_countdown = kSamplePeriod;
+  events.clear();
+}
+
+/**
+ * @brief Adds the counters and samples of other, a worker of the same
+ * search.
+ *
+ * @param other
+ */
+void SearchProfile::Merge(const SearchProfile& other) {
+  AddTo(nodes_per_depth, other.nodes_per_depth);
+  AddTo(nodes_per_vertex, other.nodes_per_vertex);
+  AddTo(backtracks, other.backtracks);
+  AddTo(backjumps, other.backjumps);
+  rejected_visited += other.rejected_visited;
+  rejected_order += other.rejected_order;
+  rejected_leaves += other.rejected_leaves;
+  extendable_copies += other.extendable_copies;
+  extendable_intersections += other.extendable_intersections;
+  rejected_edges += other.rejected_edges;
+  empty_extendable += other.empty_extendable;
+  is_neighbor_calls += other.is_neighbor_calls;
+  for (const auto& sample : other.samples) {
+    auto it = samples.find(sample.first);
+    if (it != samples.end())
+      it->second += sample.second;
+    else if (samples.size() < kMaxSampledPaths)
+      samples.insert(sample);
+    else
+      dropped_samples += sample.second;
+  }
+  dropped_samples += other.dropped_samples;
+}
+
+/**
+ * @brief Writes the profile as text: the totals, then a line per depth and a
+ * line per query vertex.
+ *
+ * @param out
+ */
+void SearchProfile::WriteReport(std::ostream& out) const {
+  if (!IsEnabled()) {
+    out << "built without SEARCH_PROFILE, nothing was counted\n";
+    return;
+  }
+  uint64_t num_nodes = 0;
+  for (uint64_t n : nodes_per_depth) num_nodes += n;
+  out << "nodes\t" << num_nodes << "\n"
+      << "rejected: visited\t" << rejected_visited << "\n"
+      << "rejected: symmetry order\t" << rejected_order << "\n"
+      << "rejected: leaves do not fit\t" << rejected_leaves << "\n"
+      << "rejected: missing edge\t" << rejected_edges << "\n"
+      << "extendable: one list\t" << extendable_copies << "\n"
+      << "extendable: intersected\t" << extendable_intersections << "\n"
+      << "extendable: empty\t" << empty_extendable << "\n"
+      << "Graph::IsNeighbor calls\t" << is_neighbor_calls << "\n"
+      << "sampled paths\t" << samples.size() << " (" << dropped_samples
+      << " samples dropped)\n";
+  for (const auto& event : events) {
+    out << event.first << "\t";
+    if (event.second < 0)
+      out << "unavailable\n";
+    else
+      out << event.second << "\n";
+  }
+
+  out << "\ndepth\tnodes\n";
+  for (size_t d = 0; d < nodes_per_depth.size(); ++d)
+    out << d << "\t" << nodes_per_depth[d] << "\n";
+
+  out << "\nvertex\tcandidates\tnodes\tbacktracks\tbackjumps\n";
+  for (size_t u = 0; u < nodes_per_vertex.size(); ++u) {
+    out << u << (static_cast<Vertex>(u) == root ? " (root)" : "")
+        << (is_leaf[u] ? " (leaf)" : "") << "\t" << num_candidates[u] << "\t"
+        << nodes_per_vertex[u] << "\t" << backtracks[u] << "\t"
+        << backjumps[u] << "\n";
+  }
+}
+
+/**
+ * @brief Writes the profile as one JSON object, without the samples.
+ *
+ * @param out
+ */
+void SearchProfile::WriteJson(std::ostream& out) const {
+  out << "{\"enabled\": " << (IsEnabled() ? "true" : "false")
+      << ", \"root\": " << root
+      << ", \"rejected_visited\": " << rejected_visited
+      << ", \"rejected_order\": " << rejected_order
+      << ", \"rejected_leaves\": " << rejected_leaves
+      << ", \"rejected_edges\": " << rejected_edges
+      << ", \"extendable_copies\": " << extendable_copies
+      << ", \"extendable_intersections\": " << extendable_intersections
+      << ", \"empty_extendable\": " << empty_extendable
+      << ", \"is_neighbor_calls\": " << is_neighbor_calls
+      << ", \"sampled_paths\": " << samples.size()
+      << ", \"dropped_samples\": " << dropped_samples << ", \"events\": {";
+  for (size_t i = 0; i < events.size(); ++i)
+    out << (i == 0 ? "" : ", ") << "\"" << events[i].first
+        << "\": " << events[i].second;
+  out << "}, \"num_candidates\": ";
+  WriteArray(out, std::vector<uint64_t>(num_candidates.begin(),
+                                        num_candidates.end()));
+  out << ", \"is_leaf\": ";
+  WriteArray(out, std::vector<uint64_t>(is_leaf.begin(), is_leaf.end()));
+  out << ", \"nodes_per_depth\": ";
+  WriteArray(out, nodes_per_depth);
+  out << ", \"nodes_per_vertex\": ";
+  WriteArray(out, nodes_per_vertex);
+  out << ", \"backtracks\": ";
+  WriteArray(out, backtracks);
+  out << ", \"backjumps\": ";
+  WriteArray(out, backjumps);
+  out << "}\n";
+}
+
+/**
+ * @brief Writes the sampled paths in the folded format of flamegraph.pl, a
+ * line "u0;u3;u1 count" per path, so that the width of a frame is the share
+ * of the search spent below that partial matching order.
+ *
+ * @param out
+ */
+void SearchProfile::WriteFoldedStacks(std::ostream& out) const {
+  for (const auto& sample : samples) {
+    const std::vector<Vertex>& path = sample.first;
+    for (size_t i = 0; i < path.size(); ++i)
+      out << (i == 0 ? "u" : ";u") << path[i];
+    out << " " << sample.second << "\n";
+  }
+}
@@ -0,0 +1,323 @@
+/**
+ * @file symmetry.cc
+ *
+ */
+
+#include "symmetry.h"
+
+namespace {
+// beyond that, the remaining symmetries are left to the search
+constexpr size_t kMaxPermutations = 1 << 12;
+// steps of all the automorphism searches of a query together; symmetry
+// breaking is given up when they run out
+constexpr size_t kSearchBudget = 1 << 20;
+
+void WriteUint64(std::ostream& out, uint64_t value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+bool ReadUint64(std::istream& in, uint64_t* value) {
+  return static_cast<bool>(
+      in.read(reinterpret_cast<char*>(value), sizeof(*value)));
+}
+}  // namespace
+
+/**
+ * @brief Leaves the query without constraints and with the identity as its
+ * only permutation.
+ *
+ * @param num_query_vertices
+ */
+void SymmetryBreaker::Clear(size_t num_query_vertices) {
+  num_vertices_ = num_query_vertices;
+  permutations_.resize(num_vertices_);
+  for (size_t u = 0; u < num_vertices_; ++u) permutations_[u] = u;
+  constraint_offset_.assign(num_vertices_ + 1, 0);
+  constraint_.clear();
+}
+
+/**
+ * @brief Writes the permutations and the constraints, all that the search
+ * reads, in a binary form for Load().
+ *
+ * @param out
+ */
+void SymmetryBreaker::Save(std::ostream& out) const {
+  WriteUint64(out, num_vertices_);
+  WriteUint64(out, permutations_.size());
+  out.write(reinterpret_cast<const char*>(permutations_.data()),
+            sizeof(Vertex) * permutations_.size());
+  for (size_t u = 0; u < num_vertices_; ++u) {
+    WriteUint64(out, GetNumConstraints(u));
+    for (size_t k = 0; k < GetNumConstraints(u); ++k) {
+      const Constraint& constraint = GetConstraint(u, k);
+      WriteUint64(out, static_cast<uint64_t>(constraint.other) << 1 |
+                           constraint.less);
+    }
+  }
+}
+
+/**
+ * @brief Reads what Save() wrote for a query of num_query_vertices vertices.
+ * On failure, the breaker is left as after Clear().
+ *
+ * @param in
+ * @param num_query_vertices
+ * @return bool false if in does not hold such a breaker.
+ */
+bool SymmetryBreaker::Load(std::istream& in, size_t num_query_vertices) {
+  Clear(num_query_vertices);
+  uint64_t n, num_entries;
+  if (!ReadUint64(in, &n) || n != num_query_vertices ||
+      !ReadUint64(in, &num_entries) || n == 0 || num_entries % n != 0 ||
+      num_entries == 0 || num_entries / n > kMaxPermutations) {
+    Clear(num_query_vertices);
+    return false;
+  }
+  permutations_.resize(num_entries);
+  bool ok = static_cast<bool>(
+      in.read(reinterpret_cast<char*>(permutations_.data()),
+              sizeof(Vertex) * num_entries));
+  for (Vertex v : permutations_) ok = ok && v >= 0 && v < Vertex(n);
+  for (size_t u = 0; u < n && ok; ++u) {
+    uint64_t num_constraints, packed;
+    ok = ReadUint64(in, &num_constraints) && num_constraints < n;
+    for (size_t k = 0; k < num_constraints && ok; ++k) {
+      ok = ReadUint64(in, &packed) && (packed >> 1) < n;
+      constraint_.push_back(
+          Constraint{static_cast<Vertex>(packed >> 1), (packed & 1) != 0});
+    }
+    constraint_offset_[u + 1] = constraint_.size();
+  }
+  if (!ok) Clear(num_query_vertices);
+  return ok;
+}
+
+/**
+ * @brief Finds the symmetries of query. Following Grochow and Kellis, it
+ * takes the core vertices one at a time, orders each against the vertices
+ * the automorphisms fixing the previous ones map it to, and keeps one
+ * automorphism per such vertex to give back the embeddings left out.
+ *
+ * @param query query graph.
+ * @param is_leaf the vertices left out of the constraints, each of degree one
+ * and hanging off a core vertex.
+ * @param arena where the temporary buffers go, the heap if null.
+ */
+void SymmetryBreaker::Build(const Graph& query,
+                            const std::vector<uint8_t>& is_leaf, Arena* arena) {
+  size_t n = query.GetNumVertices();
+  Clear(n);
+
+  // core vertices in BFS order, so that the automorphism searches map a
+  // neighbor of an already mapped vertex whenever they can
+  core_.clear();
+  ArenaVector<uint8_t> visited(n, 0, ArenaAllocator<uint8_t>(arena));
+  for (size_t s = 0; s < n; ++s) {
+    if (is_leaf[s] || visited[s]) continue;
+    size_t head = core_.size();
+    core_.push_back(s);
+    visited[s] = 1;
+    while (head < core_.size()) {
+      Vertex u = core_[head++];
+      for (size_t i = query.GetNeighborStartOffset(u);
+           i < query.GetNeighborEndOffset(u); ++i) {
+        Vertex w = query.GetNeighbor(i);
+        if (is_leaf[w] || visited[w]) continue;
+        visited[w] = 1;
+        core_.push_back(w);
+      }
+    }
+  }
+
+  // the leaves of every core vertex, in label order
+  adjacent_.assign(n * n, 0);
+  leaf_offset_.assign(n + 1, 0);
+  leaf_.clear();
+  ArenaVector<size_t> core_degree(n, 0, ArenaAllocator<size_t>(arena));
+  for (size_t u = 0; u < n; ++u) {
+    if (!is_leaf[u]) {
+      for (size_t i = query.GetNeighborStartOffset(u);
+           i < query.GetNeighborEndOffset(u); ++i) {
+        Vertex w = query.GetNeighbor(i);
+        if (is_leaf[w]) {
+          leaf_.push_back(w);
+        } else {
+          adjacent_[u * n + w] = 1;
+          ++core_degree[u];
+        }
+      }
+    }
+    leaf_offset_[u + 1] = leaf_.size();
+    std::sort(leaf_.begin() + leaf_offset_[u], leaf_.end(),
+              [&](Vertex a, Vertex b) {
+                Label la = query.GetLabel(a), lb = query.GetLabel(b);
+                return la != lb ? la < lb : a < b;
+              });
+  }
+
+  // an automorphism keeps the label, the core degree and the leaf labels:
+  // vertices sorted by those get the same color as long as they agree
+  auto leaf_labels_less = [&](Vertex a, Vertex b) {
+    size_t i = leaf_offset_[a], j = leaf_offset_[b];
+    for (; i < leaf_offset_[a + 1] && j < leaf_offset_[b + 1]; ++i, ++j) {
+      Label la = query.GetLabel(leaf_[i]), lb = query.GetLabel(leaf_[j]);
+      if (la != lb) return la < lb;
+    }
+    return j < leaf_offset_[b + 1];
+  };
+  auto color_less = [&](Vertex a, Vertex b) {
+    if (query.GetLabel(a) != query.GetLabel(b))
+      return query.GetLabel(a) < query.GetLabel(b);
+    if (core_degree[a] != core_degree[b])
+      return core_degree[a] < core_degree[b];
+    return leaf_labels_less(a, b);
+  };
+  ArenaVector<Vertex> by_color(core_.begin(), core_.end(),
+                               ArenaAllocator<Vertex>(arena));
+  std::sort(by_color.begin(), by_color.end(), color_less);
+  color_.assign(n, 0);
+  for (size_t i = 1; i < by_color.size(); ++i) {
+    color_[by_color[i]] = color_[by_color[i - 1]] +
+                          color_less(by_color[i - 1], by_color[i]);
+  }
+
+  image_.assign(n, -1);
+  used_.assign(n, 0);
+  fixed_.assign(n, 0);
+  budget_ = kSearchBudget;
+
+  // v(first) < v(second)
+  ArenaVector<std::pair<Vertex, Vertex>> less{
+      ArenaAllocator<std::pair<Vertex, Vertex>>(arena)};
+  ArenaVector<Vertex> inverse(n, 0, ArenaAllocator<Vertex>(arena));
+  ArenaVector<Vertex> level{ArenaAllocator<Vertex>(arena)};
+  for (Vertex u : core_) {
+    // the inverses of automorphisms fixing the vertices before u and mapping
+    // u to each other vertex of its orbit, after the identity
+    level.resize(n);
+    for (size_t x = 0; x < n; ++x) level[x] = x;
+    size_t orbit_size = 1;
+    for (Vertex w : core_) {
+      if (w == u || fixed_[w] || color_[w] != color_[u]) continue;
+      if (!FindAutomorphism(u, w)) {
+        if (budget_ == 0) {
+          Clear(n);
+          return;
+        }
+        continue;
+      }
+      // leaves follow their core vertex, in label order
+      for (Vertex x : core_) {
+        inverse[image_[x]] = x;
+        const Vertex* from = leaf_.data() + leaf_offset_[x];
+        const Vertex* to = leaf_.data() + leaf_offset_[image_[x]];
+        for (size_t k = 0; k < leaf_offset_[x + 1] - leaf_offset_[x]; ++k)
+          inverse[to[k]] = from[k];
+      }
+      level.insert(level.end(), inverse.begin(), inverse.end());
+      less.push_back(std::make_pair(u, w));
+      ++orbit_size;
+    }
+
+    fixed_[u] = 1;
+    if (orbit_size == 1) continue;
+    if (GetNumPermutations() * orbit_size > kMaxPermutations) {
+      less.resize(less.size() - (orbit_size - 1));
+      break;
+    }
+    // every product of one permutation per level so far
+    size_t num_permutations = GetNumPermutations();
+    products_.resize(num_permutations * orbit_size * n);
+    Vertex* out = products_.data();
+    for (size_t i = 0; i < orbit_size; ++i) {
+      const Vertex* s = level.data() + i * n;
+      for (size_t j = 0; j < num_permutations; ++j) {
+        const Vertex* p = GetPermutation(j);
+        for (size_t x = 0; x < n; ++x) *out++ = s[p[x]];
+      }
+    }
+    permutations_.swap(products_);
+  }
+
+  for (const auto& pair : less) {
+    ++constraint_offset_[pair.first + 1];
+    ++constraint_offset_[pair.second + 1];
+  }
+  for (size_t u = 0; u < n; ++u)
+    constraint_offset_[u + 1] += constraint_offset_[u];
+  constraint_.resize(constraint_offset_[n]);
+  ArenaVector<size_t> next(constraint_offset_.begin(),
+                           constraint_offset_.end() - 1,
+                           ArenaAllocator<size_t>(arena));
+  for (const auto& pair : less) {
+    constraint_[next[pair.first]++] = {pair.second, true};
+    constraint_[next[pair.second]++] = {pair.first, false};
+  }
+}
+
+/**
+ * @brief Searches for an automorphism of the core that fixes the fixed
+ * vertices and maps from to to. It is left in image_ on success.
+ *
+ * @param from
+ * @param to
+ * @return bool
+ */
+bool SymmetryBreaker::FindAutomorphism(Vertex from, Vertex to) {
+  for (Vertex x : core_) {
+    image_[x] = -1;
+    used_[x] = 0;
+  }
+  for (Vertex x : core_) {
+    if (!fixed_[x]) continue;
+    image_[x] = x;
+    used_[x] = 1;
+  }
+  if (!IsConsistent(from, to)) return false;
+  image_[from] = to;
+  used_[to] = 1;
+  return Extend(0);
+}
+
+/**
+ * @brief Maps the unmapped core vertices from core_[i] on.
+ *
+ * @param i
+ * @return bool
+ */
+bool SymmetryBreaker::Extend(size_t i) {
+  while (i < core_.size() && image_[core_[i]] >= 0) ++i;
+  if (i == core_.size()) return true;
+
+  Vertex x = core_[i];
+  for (Vertex y : core_) {
+    if (used_[y] || color_[y] != color_[x]) continue;
+    if (budget_ == 0) return false;
+    --budget_;
+    if (!IsConsistent(x, y)) continue;
+    image_[x] = y;
+    used_[y] = 1;
+    if (Extend(i + 1)) return true;
+    image_[x] = -1;
+    used_[y] = 0;
+  }
+  return false;
+}
+
+/**
+ * @brief Returns true if mapping x to y keeps the adjacency with every
+ * mapped core vertex.
+ *
+ * @param x
+ * @param y
+ * @return bool
+ */
+bool SymmetryBreaker::IsConsistent(Vertex x, Vertex y) const {
+  const uint8_t* adjacent_x = adjacent_.data() + x * num_vertices_;
+  const uint8_t* adjacent_y = adjacent_.data() + y * num_vertices_;
+  for (Vertex z : core_) {
+    if (image_[z] >= 0 && adjacent_x[z] != adjacent_y[image_[z]]) return false;
+  }
+  return true;
+}
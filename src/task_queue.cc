@@ -0,0 +1,70 @@
+/**
+ * @file task_queue.cc
+ *
+ */
+
+#include "task_queue.h"
+
+TaskQueue::TaskQueue(size_t num_workers) : deques_(num_workers) {}
+
+TaskQueue::~TaskQueue() {}
+
+/**
+ * @brief Queues a task on the worker's own deque.
+ *
+ * @param worker worker id.
+ * @param task
+ */
+void TaskQueue::Push(size_t worker, SearchTask&& task) {
+  num_outstanding_.fetch_add(1, std::memory_order_acq_rel);
+  WorkerDeque& d = deques_[worker];
+  std::lock_guard<std::mutex> lock(d.mutex);
+  d.tasks.push_back(std::move(task));
+  d.size.store(d.tasks.size(), std::memory_order_relaxed);
+}
+
+/**
+ * @brief Takes the most recently pushed task of the worker's own deque.
+ *
+ * @param worker worker id.
+ * @param task filled on success.
+ * @return bool
+ */
+bool TaskQueue::Pop(size_t worker, SearchTask& task) {
+  WorkerDeque& d = deques_[worker];
+  if (d.size.load(std::memory_order_relaxed) == 0) return false;
+  std::lock_guard<std::mutex> lock(d.mutex);
+  if (d.tasks.empty()) return false;
+  task = std::move(d.tasks.back());
+  d.tasks.pop_back();
+  d.size.store(d.tasks.size(), std::memory_order_relaxed);
+  return true;
+}
+
+/**
+ * @brief Takes the oldest task of another worker's deque.
+ *
+ * @param worker id of the stealing worker.
+ * @param task filled on success.
+ * @return bool
+ */
+bool TaskQueue::Steal(size_t worker, SearchTask& task) {
+  for (size_t i = 1; i < deques_.size(); ++i) {
+    WorkerDeque& d = deques_[(worker + i) % deques_.size()];
+    if (d.size.load(std::memory_order_relaxed) == 0) continue;
+    std::lock_guard<std::mutex> lock(d.mutex);
+    if (d.tasks.empty()) continue;
+    task = std::move(d.tasks.front());
+    d.tasks.pop_front();
+    d.size.store(d.tasks.size(), std::memory_order_relaxed);
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Marks a popped or stolen task as finished.
+ */
+void TaskQueue::Finish() {
+  num_outstanding_.fetch_sub(1, std::memory_order_acq_rel);
+}
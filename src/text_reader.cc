@@ -0,0 +1,41 @@
+/**
+ * @file text_reader.cc
+ *
+ */
+
+#include "text_reader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+TextReader::TextReader(const std::string& filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return;
+  }
+
+  is_open_ = true;
+  mapped_size_ = st.st_size;
+  if (mapped_size_ > 0) {
+    mapped_ = mmap(nullptr, mapped_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped_ == MAP_FAILED) {
+      mapped_ = nullptr;
+      is_open_ = false;
+    } else {
+      madvise(mapped_, mapped_size_, MADV_SEQUENTIAL);
+      cur_ = static_cast<const char*>(mapped_);
+      end_ = cur_ + mapped_size_;
+    }
+  }
+  close(fd);
+}
+
+TextReader::~TextReader() {
+  if (mapped_ != nullptr) munmap(mapped_, mapped_size_);
+}